@@ -1,11 +1,38 @@
+#include "param.h"
 #include "types.h"
 #include "user.h"
+#include "clock.h"
+#include "sched.h"
+#include "memlayout.h"
+#include "vdso.h"
 
 int number_of_processes = 10;
 
+static uint
+isqrt(uint n)
+{
+  uint r = 0;
+
+  while ((r + 1) * (r + 1) <= n)
+    r++;
+  return r;
+}
+
 int main(int argc, char *argv[])
 {
+  struct vdso *vdso = (struct vdso*)VDSO;
+  struct timespec start, end;
   int j;
+
+  // Run the benchmark under the policy given, if any;
+  // the children inherit it.
+  if (argc > 1 && setsched(getpid(), atoi(argv[1])) < 0)
+  {
+    printf(1, "usage: benchmark [policy 0-%d]\n", NSCHED-1);
+    exit();
+  }
+
+  clock_gettime(&start);
   for (j = 0; j < number_of_processes; j++)
   {
     // sleep(1);
@@ -47,11 +74,38 @@ int main(int argc, char *argv[])
     }
   }
 
-  uint rtime, wtime;
+  struct ptimes pt;
+  int pid, n = 0;
+  uint wait[number_of_processes], sum = 0, var = 0, mean;
   for (j = 0; j < number_of_processes+5; j++)
   {
-    waitx(&rtime, &wtime);
-    // printf(1, "%d -- Process: %d\n", wtime, j);
+    if ((pid = waitx2(&pt)) < 0)
+      continue;
+    // Times in microseconds, so short jobs do not round to 0
+    printf(1, "pid %d rtime %d us wtime %d us\n", pid,
+           pt.rtime.sec*1000000 + pt.rtime.nsec/1000,
+           pt.wtime.sec*1000000 + pt.wtime.nsec/1000);
+    if (n < number_of_processes)
+      sum += wait[n++] = pt.wtime.sec*1000 + pt.wtime.nsec/1000000;
+  }
+
+  // The wait time distribution, for comparing policies
+  if (n > 0)
+  {
+    mean = sum / n;
+    for (j = 0; j < n; j++)
+      var += (wait[j] - mean) * (wait[j] - mean);
+    printf(1, "Average wait time = %d ms\n", mean);
+    printf(1, "Standard deviation of wait time = %d ms\n", isqrt(var / n));
   }
+
+  // How the work spread over the CPUs, for comparing CPU counts
+  clock_gettime(&end);
+  printf(1, "Elapsed time = %d ms on %d CPUs\n",
+         (end.sec - start.sec)*1000 + ((int)end.nsec - (int)start.nsec)/1000000, vdso->ncpu);
+  for (j = 0; j < vdso->ncpu; j++)
+    printf(1, "cpu %d: load %d.%d%d switches %d migrated in %d out %d\n", j,
+           vdso->cpu[j].load / 100, vdso->cpu[j].load / 10 % 10, vdso->cpu[j].load % 10,
+           vdso->cpu[j].nswitch, vdso->cpu[j].nmigin, vdso->cpu[j].nmigout);
   exit();
 }
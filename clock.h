@@ -0,0 +1,16 @@
+// High-resolution times for clock_gettime() and waitx2().
+// Both the kernel and user programs use this header file.
+
+struct timespec {
+  uint sec;   // seconds
+  uint nsec;  // and nanoseconds
+};
+
+// How an exited child spent its life, as reported by waitx2().
+struct ptimes {
+  struct timespec rtime;   // running
+  struct timespec wtime;   // runnable, waiting for a CPU
+  struct timespec iotime;  // sleeping
+  int group;               // CPU group it was in, see mkgroup()
+  struct timespec gtime;   // run so far by that group and its subgroups
+};
@@ -0,0 +1,101 @@
+// Memory copy microbenchmark.
+// Times memmove() and memset() in user space, and the
+// kernel's copy paths through read() of a cached file and
+// write()/read() on a pipe with buffers that are not page
+// aligned, so the pipe has to copy rather than swap pages.
+
+#include "types.h"
+#include "stat.h"
+#include "fcntl.h"
+#include "user.h"
+
+#define BUFSZ 8192
+#define ROUNDS 2000
+#define KB (ROUNDS * (BUFSZ / 1024))
+
+char a[BUFSZ + 8], b[BUFSZ + 8];
+
+void
+report(char *what, int t0, int t1)
+{
+  printf(1, "%s: %d KB in %d ticks\n", what, KB, t1 - t0);
+}
+
+void
+usercopy(void)
+{
+  int i, t0;
+
+  t0 = uptime();
+  for(i = 0; i < ROUNDS; i++)
+    memmove(a, b, BUFSZ);
+  report("memmove aligned", t0, uptime());
+
+  t0 = uptime();
+  for(i = 0; i < ROUNDS; i++)
+    memmove(a + 1, b + 3, BUFSZ);
+  report("memmove unaligned", t0, uptime());
+
+  t0 = uptime();
+  for(i = 0; i < ROUNDS; i++)
+    memset(a + 1, i, BUFSZ);
+  report("memset", t0, uptime());
+}
+
+void
+filecopy(void)
+{
+  int fd, i, t0;
+
+  fd = open("copybench.tmp", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, b, BUFSZ) != BUFSZ){
+    printf(2, "copybench: cannot create copybench.tmp\n");
+    exit();
+  }
+  close(fd);
+
+  t0 = uptime();
+  for(i = 0; i < ROUNDS; i++){
+    fd = open("copybench.tmp", O_RDONLY);
+    if(read(fd, a + 1, BUFSZ) != BUFSZ){
+      printf(2, "copybench: short read\n");
+      exit();
+    }
+    close(fd);
+  }
+  report("file read", t0, uptime());
+  unlink("copybench.tmp");
+}
+
+void
+pipecopy(void)
+{
+  int fds[2], i, n, tot, t0;
+
+  if(pipe(fds) != 0){
+    printf(2, "copybench: pipe failed\n");
+    exit();
+  }
+  t0 = uptime();
+  if(fork() == 0){
+    close(fds[0]);
+    for(i = 0; i < ROUNDS; i++)
+      write(fds[1], b + 1, BUFSZ);
+    exit();
+  }
+  close(fds[1]);
+  for(tot = 0; (n = read(fds[0], a + 1, BUFSZ)) > 0; tot += n)
+    ;
+  close(fds[0]);
+  wait();
+  report("pipe", t0, uptime());
+}
+
+int
+main(int argc, char *argv[])
+{
+  usercopy();
+  filecopy();
+  pipecopy();
+  exit();
+}
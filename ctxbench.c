@@ -0,0 +1,57 @@
+// Context switch benchmark.
+// A parent and child bounce one byte back and forth over
+// a pair of pipes, so every round trip costs two sleeps,
+// two wakeups and at least two context switches on one CPU.
+// Run it with CPUS=1 to measure the switch path alone.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define ROUNDS 20000
+
+int
+main(int argc, char *argv[])
+{
+  int ping[2], pong[2], pid, i, n, t0, t1;
+  char c;
+
+  n = argc > 1 ? atoi(argv[1]) : ROUNDS;
+  if(pipe(ping) != 0 || pipe(pong) != 0){
+    printf(2, "ctxbench: pipe failed\n");
+    exit();
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf(2, "ctxbench: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    for(i = 0; i < n; i++){
+      if(read(ping[0], &c, 1) != 1 || write(pong[1], &c, 1) != 1){
+        printf(2, "ctxbench: child i/o failed\n");
+        exit();
+      }
+    }
+    exit();
+  }
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    c = i;
+    if(write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1){
+      printf(2, "ctxbench: parent i/o failed\n");
+      exit();
+    }
+    if(c != (char)i){
+      printf(2, "ctxbench: wrong byte in round %d\n", i);
+      exit();
+    }
+  }
+  t1 = uptime();
+  wait();
+
+  printf(1, "%d round trips in %d ticks\n", n, t1 - t0);
+  exit();
+}
@@ -0,0 +1,190 @@
+// Directory name lookup cache.
+//
+// Without it, dirlookup() reads every block of a directory and
+// compares every entry against the name it is looking for, once
+// per path component, on every open, exec, chdir and unlink.
+// The dcache remembers the outcome of earlier lookups, keyed by
+// (device, directory inum, name), in a small hash table.
+//
+// An entry with inum 0 is a negative entry: the name is known
+// not to be in the directory. Positive entries also remember the
+// byte offset of the dirent, so unlink() need not scan either.
+//
+// Interface (all callers must hold the directory's inode lock,
+// which keeps an entry from changing between lookup and use):
+// * dcachelookup returns 1 and fills in inum/off on a hit.
+// * dcacheenter records the result of a lookup or a dirlink.
+// * dcachepurge drops every name cached under a directory
+//   inode that is being freed, since its inum will be reused.
+//
+// Directory contents only change in dirlink() and unlink(),
+// and both keep the cache up to date.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+#define NDHASH 61  // hash buckets; prime to spread inums
+
+struct dentry {
+  uint dev;
+  uint dir;              // inum of directory holding name; 0 if free
+  char name[DIRSIZ];
+  uint inum;             // 0 for a negative entry
+  uint off;              // byte offset of the dirent in dir
+  struct dentry *hnext;  // hash chain
+  struct dentry *prev;   // LRU list
+  struct dentry *next;
+};
+
+struct {
+  struct spinlock lock;
+  struct dentry dentry[NDENTRY];
+  struct dentry *hash[NDHASH];
+
+  // Linked list of all entries, through prev/next.
+  // head.next is most recently used.
+  struct dentry head;
+} dcache;
+
+void
+dcacheinit(void)
+{
+  struct dentry *d;
+
+  initlock(&dcache.lock, "dcache");
+  dcache.head.prev = &dcache.head;
+  dcache.head.next = &dcache.head;
+  for(d = dcache.dentry; d < dcache.dentry+NDENTRY; d++){
+    d->next = dcache.head.next;
+    d->prev = &dcache.head;
+    dcache.head.next->prev = d;
+    dcache.head.next = d;
+  }
+}
+
+static uint
+dhash(uint dev, uint dir, char *name)
+{
+  uint h;
+  int i;
+
+  h = dev*31 + dir;
+  for(i = 0; i < DIRSIZ && name[i]; i++)
+    h = h*31 + (uchar)name[i];
+  return h % NDHASH;
+}
+
+// Find the entry for name in dir.
+// Must hold dcache.lock.
+static struct dentry*
+dget(uint dev, uint dir, char *name)
+{
+  struct dentry *d;
+
+  for(d = dcache.hash[dhash(dev, dir, name)]; d; d = d->hnext)
+    if(d->dev == dev && d->dir == dir && namecmp(d->name, name) == 0)
+      return d;
+  return 0;
+}
+
+// Unhash d and move it to the LRU end of the list.
+// Must hold dcache.lock.
+static void
+dfree(struct dentry *d)
+{
+  struct dentry **pp;
+
+  for(pp = &dcache.hash[dhash(d->dev, d->dir, d->name)]; *pp; pp = &(*pp)->hnext){
+    if(*pp == d){
+      *pp = d->hnext;
+      break;
+    }
+  }
+  d->dir = 0;
+  d->hnext = 0;
+  d->next->prev = d->prev;
+  d->prev->next = d->next;
+  d->next = &dcache.head;
+  d->prev = dcache.head.prev;
+  dcache.head.prev->next = d;
+  dcache.head.prev = d;
+}
+
+// Move d to the MRU end of the list.
+// Must hold dcache.lock.
+static void
+dtouch(struct dentry *d)
+{
+  d->next->prev = d->prev;
+  d->prev->next = d->next;
+  d->next = dcache.head.next;
+  d->prev = &dcache.head;
+  dcache.head.next->prev = d;
+  dcache.head.next = d;
+}
+
+// Look for name in directory dp.
+// Returns 1 and sets *inum (0 if the name is known
+// to be absent) and *off on a hit, 0 on a miss.
+int
+dcachelookup(struct inode *dp, char *name, uint *inum, uint *off)
+{
+  struct dentry *d;
+
+  acquire(&dcache.lock);
+  if((d = dget(dp->dev, dp->inum, name)) == 0){
+    release(&dcache.lock);
+    return 0;
+  }
+  *inum = d->inum;
+  *off = d->off;
+  dtouch(d);
+  release(&dcache.lock);
+  return 1;
+}
+
+// Record that name in directory dp refers to inum,
+// stored at byte offset off, or is absent if inum is 0.
+// Recycles the least recently used entry if needed.
+void
+dcacheenter(struct inode *dp, char *name, uint inum, uint off)
+{
+  struct dentry *d;
+  uint h;
+
+  acquire(&dcache.lock);
+  if((d = dget(dp->dev, dp->inum, name)) == 0){
+    d = dcache.head.prev;
+    if(d->dir)
+      dfree(d);
+    d->dev = dp->dev;
+    d->dir = dp->inum;
+    strncpy(d->name, name, DIRSIZ);
+    h = dhash(d->dev, d->dir, d->name);
+    d->hnext = dcache.hash[h];
+    dcache.hash[h] = d;
+  }
+  d->inum = inum;
+  d->off = off;
+  dtouch(d);
+  release(&dcache.lock);
+}
+
+// Forget every name cached under directory inum on dev.
+// Called when the directory inode is freed.
+void
+dcachepurge(uint dev, uint dir)
+{
+  struct dentry *d;
+
+  acquire(&dcache.lock);
+  for(d = dcache.dentry; d < dcache.dentry+NDENTRY; d++)
+    if(d->dir == dir && d->dev == dev)
+      dfree(d);
+  release(&dcache.lock);
+}
@@ -1,14 +1,21 @@
 struct buf;
 struct context;
 struct file;
+struct group;
 struct inode;
+struct iovec;
 struct pipe;
 struct proc;
+struct rbtree;
+struct rq;
 struct rtcdate;
+struct sched_class;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct timespec;
+struct vdso;
 typedef struct _Queue Queue;
 
 // bio.c
@@ -23,6 +30,12 @@ void            cprintf(char*, ...);
 void            consoleintr(int(*)(void));
 void            panic(char*) __attribute__((noreturn));
 
+// dcache.c
+void            dcacheinit(void);
+int             dcachelookup(struct inode*, char*, uint*, uint*);
+void            dcacheenter(struct inode*, char*, uint, uint);
+void            dcachepurge(uint, uint);
+
 // exec.c
 int             exec(char*, char**);
 
@@ -32,8 +45,10 @@ void            fileclose(struct file*);
 struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
+int             filereadv(struct file*, struct iovec*, int, int);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
+int             filewritev(struct file*, struct iovec*, int, int);
 
 // fs.c
 void            readsb(int dev, struct superblock *sb);
@@ -100,7 +115,9 @@ void            picinit(void);
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, char*, int);
+int             pipereadv(struct pipe*, struct iovec*, int);
 int             pipewrite(struct pipe*, char*, int);
+int             pipegift(struct pipe*, char*, int);
 
 //PAGEBREAK: 16
 // proc.c
@@ -117,16 +134,55 @@ void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
+int             sleepticks(int);
+void            lockwait(struct sleeplock*);
+void            lockrelease(struct proc*);
 void            userinit(void);
 int             wait(void);
-int             waitx(uint* wtime, uint* rtime);
+int             waitx(uint64*, uint64*, uint64*, int*, uint64*);
 void            wakeup(void*);
 void            yield(void);
 int             set_priority(int new_priority, int pid);
 int             ps(void);
-void            punisher(void);
-void            inc_timeslice(void);
-void            update_timing(void);
+int             setsched(int, int);
+int             settickets(int, int);
+int             setdeadline(uint, uint, uint);
+int             setaffinity(int, uint);
+int             setagethres(int);
+int             mkgroup(int);
+int             setgroup(int, int);
+int             groupctl(int, int, int, int);
+void            schedtick(void);
+
+// group.c
+void            groupinit(void);
+struct group*   groupalloc(struct group*);
+void            groupactive(struct proc*, int);
+int             groupjoin(struct proc*, struct group*);
+int             groupset(struct group*, uint, uint, uint);
+int             groupfree(struct group*);
+void            groupcharge(struct proc*);
+uint64          groupusage(struct group*);
+int             groupthrottled(struct group*);
+uint            groupweight(struct group*, uint);
+
+// sched.c
+void            schedinit(void);
+uint            prioweight(int);
+extern int      defpolicy;
+extern int      agethres;
+int             schedpreempt(struct proc*);
+void            schedenqueue(struct proc*);
+void            schedwake(struct proc*, int);
+void            scheddequeue(struct proc*);
+void            scheddetach(struct proc*);
+struct rq*      schedlock(struct proc*);
+void            schedunlock(struct proc*, struct rq*);
+struct proc*    schedpick(struct cpu*);
+void            schedbalance(struct cpu*, int);
+int             schedclock(struct cpu*);
+extern struct sched_class *sched_classes[];
+extern struct sched_class *sched_order[];
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -172,6 +228,15 @@ extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
 
+// tsc.c
+void            tscinit(void);
+uint64          div64(uint64, uint);
+uint            cyc2ticks(uint64);
+uint64          us2cyc(uint);
+void            cyc2ts(uint64, struct timespec*);
+extern uint     tsckhz;
+extern uint64   tscboot;
+
 // uart.c
 void            uartinit(void);
 void            uartintr(void);
@@ -180,6 +245,9 @@ void            uartputc(int);
 // vm.c
 void            seginit(void);
 void            kvmalloc(void);
+void            vdsoinit(void);
+extern struct vdso *vdso;
+int             mapvdso(pde_t*, char*);
 pde_t*          setupkvm(void);
 char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
@@ -191,10 +259,17 @@ pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
+int             swapupage(pde_t*, char*, char**);
 void            clearpteu(pde_t *pgdir, char *uva);
 
+// rbtree.c
+void            rbinsert(struct rbtree*, struct proc*);
+void            rberase(struct proc*);
+
 // queue.c
 void            push(Queue* queue, struct proc* proc);
+void            push_sorted(Queue* queue, struct proc* proc, int (*before)(struct proc*, struct proc*));
+void            qremove(struct proc* proc);
 struct proc*    pop(Queue* queue);
 void            display(Queue* queue);
 int             get_size(Queue* queue);
@@ -217,5 +292,3 @@ int             get_size(Queue* queue);
     -1: /*Error as the maximum number of queues are 5*/ \
     ((b >= (1 << a))? 1: 0)\
 )
-
-#define AGE_THRES 2
@@ -0,0 +1,130 @@
+// Deadline benchmark.
+// NTASK periodic tasks each have WORK ms of computation to do
+// every PERIOD ms, due by the end of the period, while two CPU
+// hogs per CPU compete with them under the default policy.
+// Each task counts the periods whose work finished late. With
+// an argument of 1 (the default) the tasks reserve their time
+// with setdeadline; with 0 they run like the hogs.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "memlayout.h"
+#include "vdso.h"
+#include "clock.h"
+
+#define NTASK   3
+#define PERIOD  100  // ms
+#define WORK    20   // ms
+#define JOBS    30
+
+static uint loops_per_ms;
+
+static uint
+now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(&ts);
+  return ts.sec*1000 + ts.nsec/1000000;
+}
+
+static void
+spin(uint n)
+{
+  volatile uint i;
+
+  for(i = 0; i < n; i++)
+    ;
+}
+
+// How many iterations of spin() take a millisecond,
+// measured before anything else is running.
+static void
+calibrate(void)
+{
+  uint n, t, t0;
+
+  n = 1 << 16;
+  do {
+    n *= 2;
+    t0 = now_ms();
+    spin(n);
+    t = now_ms() - t0;
+  } while(t < 50);
+  loops_per_ms = n / t;
+}
+
+static void
+task(int fd, int reserve)
+{
+  int j, misses;
+  uint release;
+
+  misses = 0;
+  if(reserve && setdeadline(WORK*1000*3/2, PERIOD*1000, PERIOD*1000) < 0){
+    printf(2, "dlbench: setdeadline refused\n");
+    misses = -1;
+    write(fd, &misses, sizeof(misses));
+    exit();
+  }
+  release = now_ms();
+  for(j = 0; j < JOBS; j++){
+    spin(WORK * loops_per_ms);
+    if(now_ms() > release + PERIOD)
+      misses++;
+    release += PERIOD;
+    while(now_ms() < release)
+      sleep(1);
+  }
+  write(fd, &misses, sizeof(misses));
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fds[2], hogs[2*NCPU], nhog, reserve, i, m, misses;
+
+  reserve = argc > 1 ? atoi(argv[1]) : 1;
+  calibrate();
+  if(pipe(fds) < 0){
+    printf(2, "dlbench: pipe failed\n");
+    exit();
+  }
+
+  nhog = 2 * ((struct vdso*)VDSO)->ncpu;
+  for(i = 0; i < nhog; i++){
+    if((hogs[i] = fork()) == 0)
+      for(;;)
+        ;
+  }
+  for(i = 0; i < NTASK; i++){
+    if(fork() == 0){
+      close(fds[0]);
+      task(fds[1], reserve);
+    }
+  }
+  close(fds[1]);
+
+  misses = 0;
+  for(i = 0; i < NTASK; i++){
+    if(read(fds[0], &m, sizeof(m)) != sizeof(m) || m < 0){
+      misses = -1;
+      break;
+    }
+    misses += m;
+  }
+  for(i = 0; i < nhog; i++)
+    kill(hogs[i]);
+  while(wait() >= 0)
+    ;
+
+  if(misses < 0)
+    printf(1, "dlbench: a task failed\n");
+  else
+    printf(1, "%s: %d of %d deadlines missed, %d hogs\n",
+           reserve ? "EDF" : "no reservation", misses, NTASK*JOBS, nhog);
+  exit();
+}
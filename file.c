@@ -9,6 +9,7 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "uio.h"
 
 struct devsw devsw[NDEV];
 struct {
@@ -92,37 +93,79 @@ filestat(struct file *f, struct stat *st)
   return -1;
 }
 
-// Read from file f.
+// Read from file f into the buffers in iov, in order.
+// If off is -1, read at f->off and advance it; otherwise
+// read at off and leave f->off alone. The inode stays locked
+// across all the buffers, so the read is not interleaved
+// with other writes to the file.
 int
-fileread(struct file *f, char *addr, int n)
+filereadv(struct file *f, struct iovec *iov, int cnt, int off)
 {
-  int r;
+  int r, tot;
+  uint o;
 
   if(f->readable == 0)
     return -1;
-  if(f->type == FD_PIPE)
-    return piperead(f->pipe, addr, n);
+  if(f->type == FD_PIPE){
+    if(off != -1)
+      return -1;
+    return pipereadv(f->pipe, iov, cnt);
+  }
   if(f->type == FD_INODE){
+    tot = 0;
     ilock(f->ip);
-    if((r = readi(f->ip, addr, f->off, n)) > 0)
-      f->off += r;
+    o = off == -1 ? f->off : off;
+    for(; cnt > 0; iov++, cnt--){
+      if((r = readi(f->ip, iov->iov_base, o, iov->iov_len)) < 0){
+        if(tot == 0)
+          tot = -1;
+        break;
+      }
+      o += r;
+      tot += r;
+      if(r < iov->iov_len)
+        break;
+    }
+    if(off == -1)
+      f->off = o;
     iunlock(f->ip);
-    return r;
+    return tot;
   }
   panic("fileread");
 }
 
+// Read from file f.
+int
+fileread(struct file *f, char *addr, int n)
+{
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, -1);
+}
+
 //PAGEBREAK!
-// Write to file f.
+// Write the buffers in iov to file f, in order.
+// off is as for filereadv().
 int
-filewrite(struct file *f, char *addr, int n)
+filewritev(struct file *f, struct iovec *iov, int cnt, int off)
 {
-  int r;
+  int r, i, n, n1, tot;
+  uint o;
 
   if(f->writable == 0)
     return -1;
-  if(f->type == FD_PIPE)
-    return pipewrite(f->pipe, addr, n);
+  if(f->type == FD_PIPE){
+    if(off != -1)
+      return -1;
+    for(tot = 0; cnt > 0; iov++, cnt--){
+      if(pipewrite(f->pipe, iov->iov_base, iov->iov_len) < 0)
+        return -1;
+      tot += iov->iov_len;
+    }
+    return tot;
+  }
   if(f->type == FD_INODE){
     // write a few blocks at a time to avoid exceeding
     // the maximum log transaction size, including
@@ -130,28 +173,51 @@ filewrite(struct file *f, char *addr, int n)
     // and 2 blocks of slop for non-aligned writes.
     // this really belongs lower down, since writei()
     // might be writing a device like the console.
+    // small buffers are packed into one transaction;
+    // the bytes are contiguous in the file, so the
+    // same bound holds.
     int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
-    int i = 0;
-    while(i < n){
-      int n1 = n - i;
-      if(n1 > max)
-        n1 = max;
-
+    tot = 0;
+    i = 0;  // bytes of iov[0] already written
+    r = 0;
+    while(cnt > 0 && r >= 0){
       begin_op();
       ilock(f->ip);
-      if ((r = writei(f->ip, addr + i, f->off, n1)) > 0)
-        f->off += r;
+      o = off == -1 ? f->off : off + tot;
+      for(n = 0; cnt > 0 && n < max; n += r){
+        n1 = iov->iov_len - i;
+        if(n1 > max - n)
+          n1 = max - n;
+        if((r = writei(f->ip, (char*)iov->iov_base + i, o + n, n1)) < 0)
+          break;
+        if(r != n1)
+          panic("short filewrite");
+        i += r;
+        if(i == iov->iov_len){
+          iov++;
+          cnt--;
+          i = 0;
+        }
+      }
+      if(off == -1)
+        f->off = o + n;
       iunlock(f->ip);
       end_op();
-
-      if(r < 0)
-        break;
-      if(r != n1)
-        panic("short filewrite");
-      i += r;
+      tot += n;
     }
-    return i == n ? n : -1;
+    return cnt == 0 ? tot : -1;
   }
   panic("filewrite");
 }
 
+// Write to file f.
+int
+filewrite(struct file *f, char *addr, int n)
+{
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, -1);
+}
+
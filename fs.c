@@ -14,8 +14,8 @@
 #include "param.h"
 #include "stat.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
@@ -338,6 +338,8 @@ iput(struct inode *ip)
     release(&icache.lock);
     if(r == 1){
       // inode has no links and no other references: truncate and free.
+      if(ip->type == T_DIR)
+        dcachepurge(ip->dev, ip->inum);
       itrunc(ip);
       ip->type = 0;
       iupdate(ip);
@@ -519,8 +521,214 @@ namecmp(const char *s, const char *t)
   return strncmp(s, t, DIRSIZ);
 }
 
+// Hash a directory entry name for the directory index.
+// mkfs.c has a copy; the two must agree.
+static uint
+dirhash(char *name)
+{
+  uint h;
+  int i;
+
+  h = 2166136261;
+  for(i = 0; i < DIRSIZ && name[i]; i++){
+    h ^= (uchar)name[i];
+    h *= 16777619;
+  }
+  return h;
+}
+
+// Return the index of the last slot in dx
+// whose hash is <= h, by binary search.
+static int
+dxfind(struct dxroot *dx, uint h)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = dx->nslot - 1;
+  while(lo < hi){
+    mid = (lo + hi + 1) / 2;
+    if(dx->slot[mid].hash <= h)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return lo;
+}
+
+// Look for name in indexed directory dp.
+// If found, set *poff and return its inum, else return 0.
+static uint
+dxlookup(struct inode *dp, char *name, uint *poff)
+{
+  struct buf *bp;
+  struct dxroot *dx;
+  struct dirent *de;
+  uint lb, inum;
+  int i;
+
+  bp = bread(dp->dev, bmap(dp, 0));
+  dx = (struct dxroot*)bp->data;
+  for(de = &dx->dot; de <= &dx->dotdot; de++){
+    if(namecmp(name, de->name) == 0){
+      *poff = (char*)de - (char*)dx;
+      inum = de->inum;
+      brelse(bp);
+      return inum;
+    }
+  }
+  lb = dx->slot[dxfind(dx, dirhash(name))].block;
+  brelse(bp);
+
+  bp = bread(dp->dev, bmap(dp, lb));
+  de = (struct dirent*)bp->data;
+  for(i = 0; i < DPB; i++){
+    if(de[i].inum && namecmp(name, de[i].name) == 0){
+      *poff = lb*BSIZE + i*sizeof(*de);
+      inum = de[i].inum;
+      brelse(bp);
+      return inum;
+    }
+  }
+  brelse(bp);
+  return 0;
+}
+
+// Turn the one-block plain directory dp into an indexed
+// directory: the entries after "." and ".." move to a new
+// leaf in block 1, and block 0 becomes the index.
+static void
+dxconvert(struct inode *dp)
+{
+  struct buf *rbp, *bp;
+  struct dxroot *dx;
+
+  rbp = bread(dp->dev, bmap(dp, 0));
+  bp = bread(dp->dev, bmap(dp, 1));
+  memmove(bp->data, rbp->data, BSIZE);
+  memset(bp->data, 0, 2*sizeof(struct dirent));
+  dx = (struct dxroot*)rbp->data;
+  memset(&dx->zero, 0, BSIZE - 2*sizeof(struct dirent));
+  dx->nslot = 1;
+  dx->slot[0].block = 1;
+  dx->slot[0].hash = 0;
+  log_write(bp);
+  log_write(rbp);
+  brelse(bp);
+  brelse(rbp);
+
+  dp->size = 2*BSIZE;
+  dp->major |= DIR_INDEXED;
+  iupdate(dp);
+
+  // Every entry has moved.
+  dcachepurge(dp->dev, dp->inum);
+}
+
+// Put name at a free dirent in the leaf held by bp.
+// Returns the byte offset within the leaf, or -1 if full.
+static int
+dxput(struct buf *bp, char *name, uint inum)
+{
+  struct dirent *de;
+  int i;
+
+  de = (struct dirent*)bp->data;
+  for(i = 0; i < DPB; i++){
+    if(de[i].inum == 0){
+      strncpy(de[i].name, name, DIRSIZ);
+      de[i].inum = inum;
+      log_write(bp);
+      return i*sizeof(*de);
+    }
+  }
+  return -1;
+}
+
+// Write a new directory entry (name, inum) into the
+// indexed directory dp, splitting its leaf in two at
+// the median hash if the leaf is full.
+// Returns -1 if the index has no room for another leaf.
+static int
+dxlink(struct inode *dp, char *name, uint inum)
+{
+  struct buf *rbp, *bp, *nbp;
+  struct dxroot *dx;
+  struct dirent *de, *nde;
+  uint h, m, lb, nb, hs[DPB], t;
+  int s, i, j, off;
+
+  h = dirhash(name);
+  rbp = bread(dp->dev, bmap(dp, 0));
+  dx = (struct dxroot*)rbp->data;
+  s = dxfind(dx, h);
+  lb = dx->slot[s].block;
+  bp = bread(dp->dev, bmap(dp, lb));
+  if((off = dxput(bp, name, inum)) >= 0){
+    brelse(bp);
+    brelse(rbp);
+    dcacheenter(dp, name, inum, lb*BSIZE + off);
+    return 0;
+  }
+
+  // Leaf is full. Entries with equal hashes must share a
+  // leaf, so split at the median hash, or failing that at
+  // the first hash above the smallest.
+  de = (struct dirent*)bp->data;
+  for(i = 0; i < DPB; i++){
+    t = dirhash(de[i].name);
+    for(j = i; j > 0 && hs[j-1] > t; j--)
+      hs[j] = hs[j-1];
+    hs[j] = t;
+  }
+  m = hs[DPB/2];
+  for(i = 1; m == hs[0] && i < DPB; i++)
+    m = hs[i];
+  nb = dp->size / BSIZE;
+  if(m == hs[0] || dx->nslot == NDXSLOT || nb >= MAXFILE){
+    brelse(bp);
+    brelse(rbp);
+    return -1;
+  }
+
+  nbp = bread(dp->dev, bmap(dp, nb));
+  nde = (struct dirent*)nbp->data;
+  for(i = j = 0; i < DPB; i++){
+    if(dirhash(de[i].name) >= m){
+      nde[j++] = de[i];
+      memset(&de[i], 0, sizeof(de[i]));
+    }
+  }
+  memmove(&dx->slot[s+2], &dx->slot[s+1], (dx->nslot-s-1)*sizeof(dx->slot[0]));
+  dx->slot[s+1].zero = 0;
+  dx->slot[s+1].block = nb;
+  dx->slot[s+1].hash = m;
+  dx->nslot++;
+  log_write(rbp);
+  log_write(bp);
+  log_write(nbp);
+  dp->size += BSIZE;
+  iupdate(dp);
+
+  // Entries have moved to the new leaf.
+  dcachepurge(dp->dev, dp->inum);
+
+  if(h >= m){
+    off = nb*BSIZE + dxput(nbp, name, inum);
+  } else {
+    off = lb*BSIZE + dxput(bp, name, inum);
+  }
+  brelse(nbp);
+  brelse(bp);
+  brelse(rbp);
+  dcacheenter(dp, name, inum, off);
+  return 0;
+}
+
 // Look for a directory entry in a directory.
 // If found, set *poff to byte offset of entry.
+// Consults the dcache first and records the outcome
+// of a full scan there, found or not.
 struct inode*
 dirlookup(struct inode *dp, char *name, uint *poff)
 {
@@ -530,6 +738,24 @@ dirlookup(struct inode *dp, char *name, uint *poff)
   if(dp->type != T_DIR)
     panic("dirlookup not DIR");
 
+  if(dcachelookup(dp, name, &inum, &off)){
+    if(inum == 0)
+      return 0;
+    if(poff)
+      *poff = off;
+    return iget(dp->dev, inum);
+  }
+
+  if(dp->major & DIR_INDEXED){
+    inum = dxlookup(dp, name, &off);
+    dcacheenter(dp, name, inum, off);
+    if(inum == 0)
+      return 0;
+    if(poff)
+      *poff = off;
+    return iget(dp->dev, inum);
+  }
+
   for(off = 0; off < dp->size; off += sizeof(de)){
     if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
       panic("dirlookup read");
@@ -540,10 +766,12 @@ dirlookup(struct inode *dp, char *name, uint *poff)
       if(poff)
         *poff = off;
       inum = de.inum;
+      dcacheenter(dp, name, inum, off);
       return iget(dp->dev, inum);
     }
   }
 
+  dcacheenter(dp, name, 0, 0);
   return 0;
 }
 
@@ -561,6 +789,15 @@ dirlink(struct inode *dp, char *name, uint inum)
     return -1;
   }
 
+  if(dp->major & DIR_INDEXED){
+    if(dxlink(dp, name, inum) == 0)
+      return 0;
+    // The index is full. Its slots read as free dirents,
+    // so dropping the flag leaves a valid plain directory.
+    dp->major &= ~DIR_INDEXED;
+    iupdate(dp);
+  }
+
   // Look for an empty dirent.
   for(off = 0; off < dp->size; off += sizeof(de)){
     if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
@@ -569,10 +806,17 @@ dirlink(struct inode *dp, char *name, uint inum)
       break;
   }
 
+  // Index a directory once it outgrows its first block.
+  if(off == BSIZE && dp->size == BSIZE){
+    dxconvert(dp);
+    return dxlink(dp, name, inum);
+  }
+
   strncpy(de.name, name, DIRSIZ);
   de.inum = inum;
   if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
     panic("dirlink");
+  dcacheenter(dp, name, inum, off);
 
   return 0;
 }
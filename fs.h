@@ -55,3 +55,33 @@ struct dirent {
   char name[DIRSIZ];
 };
 
+// Directory entries per block.
+#define DPB           (BSIZE / sizeof(struct dirent))
+
+// Indexed directories.
+// A directory with DIR_INDEXED set in its major number keeps a
+// hash index in block 0, after the "." and ".." entries. Every
+// other block is a leaf holding the names whose hash lies in
+// [slot[i].hash, slot[i+1].hash), so a lookup reads block 0 and
+// one leaf. Each 16-byte piece of the index starts with a zero
+// ushort, so code that reads the directory as an array of
+// dirents (ls, isdirempty) sees only free entries there.
+#define DIR_INDEXED 1
+
+struct dxslot {
+  ushort zero;       // always 0
+  ushort block;      // leaf's block number within the directory
+  uint hash;         // smallest name hash stored in the leaf
+};
+
+#define NDXSLOT ((BSIZE - 2*sizeof(struct dirent) - 8) / sizeof(struct dxslot))
+
+struct dxroot {
+  struct dirent dot;
+  struct dirent dotdot;
+  ushort zero;       // always 0
+  ushort nslot;      // slots in use; slot[0].hash is 0
+  uint pad;
+  struct dxslot slot[NDXSLOT];
+};
+
@@ -0,0 +1,272 @@
+// CPU groups, like the cpu controller of Linux's cgroups.
+//
+// Groups form a tree under the root group, group 0, which
+// every process is in until it is moved. A group's processes
+// and child groups share the CPU time the group gets: under
+// CFS each process's weight is scaled, at every level from its
+// group up to the root, by that group's shares over the load of
+// the group itself, so that each group gets CPU time in
+// proportion to its shares among its active siblings however
+// many processes it has. A group may also have a quota of CPU
+// time in each period; once it, or any group above it, has used
+// its quota, its processes are held off their CPUs until the
+// period ends (see schedpick in sched.c). The run time of every
+// process is charged to its group and all the groups above.
+// grouplock protects all the groups and every process's group,
+// gweight and gcharged; it is taken last, after any run queue
+// or process lock (see proc.c).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+
+struct group groups[NGROUP];
+static struct spinlock grouplock;
+
+static void groupcharge1(struct proc*);
+
+#define DEFPERIOD  100000  // us
+
+void
+groupinit(void)
+{
+  initlock(&grouplock, "group");
+  groups[0].inuse = 1;
+  groups[0].shares = DEFSHARES;
+  groups[0].period = us2cyc(DEFPERIOD);
+}
+
+// Make a group under parent, with no quota.
+// Returns 0 if parent is not in use or there is no room.
+struct group*
+groupalloc(struct group *parent)
+{
+  struct group *g;
+
+  acquire(&grouplock);
+  for(g = groups; g < &groups[NGROUP]; g++)
+    if(!g->inuse)
+      break;
+  if(g == &groups[NGROUP] || !parent->inuse){
+    release(&grouplock);
+    return 0;
+  }
+  memset(g, 0, sizeof(*g));
+  g->inuse = 1;
+  g->parent = parent;
+  g->shares = DEFSHARES;
+  g->period = us2cyc(DEFPERIOD);
+  g->start = rdtsc();
+  parent->nchild++;
+  release(&grouplock);
+  return g;
+}
+
+// Free g, and then its parent, once it has
+// lost its last process and child group.
+static void
+groupput(struct group *g)
+{
+  while(g->parent && g->nproc == 0 && g->nchild == 0){
+    g->inuse = 0;
+    g = g->parent;
+    g->nchild--;
+  }
+}
+
+// Account for p becoming active, RUNNABLE or RUNNING, or
+// inactive: its weight joins or leaves its group's load, and a
+// group that gains its first active process, or loses its last,
+// joins or leaves its parent's load.
+static void
+groupactive1(struct proc *p, int active)
+{
+  struct group *g = p->group;
+
+  if(active){
+    p->gweight = prioweight(p->priority);
+    g->load += p->gweight;
+  } else
+    g->load -= p->gweight;
+  for(; g != 0; g = g->parent){
+    if(active ? g->nactive++ > 0 : --g->nactive > 0)
+      continue;
+    if(g->parent){
+      if(active)
+        g->parent->load += g->shares;
+      else
+        g->parent->load -= g->shares;
+    }
+  }
+}
+
+void
+groupactive(struct proc *p, int active)
+{
+  acquire(&grouplock);
+  groupactive1(p, active);
+  release(&grouplock);
+}
+
+static int
+isactive(struct proc *p)
+{
+  return p->state == RUNNABLE || p->state == RUNNING;
+}
+
+// Move p into group g, or with g 0 out of its group.
+// Returns -1 if g is not in use.
+int
+groupjoin(struct proc *p, struct group *g)
+{
+  struct group *old = p->group;
+
+  acquire(&grouplock);
+  if(g && !g->inuse){
+    release(&grouplock);
+    return -1;
+  }
+  if(old){
+    groupcharge1(p);
+    if(isactive(p))
+      groupactive1(p, 0);
+    old->nproc--;
+  }
+  p->group = g;
+  if(g){
+    g->nproc++;
+    if(isactive(p))
+      groupactive1(p, 1);
+  }
+  if(old)
+    groupput(old);
+  release(&grouplock);
+  return 0;
+}
+
+// Set g's shares, and its quota and period in us; no quota if 0.
+// Returns -1 if g is not in use.
+int
+groupset(struct group *g, uint shares, uint quota, uint period)
+{
+  acquire(&grouplock);
+  if(!g->inuse){
+    release(&grouplock);
+    return -1;
+  }
+  if(g->nactive > 0 && g->parent)
+    g->parent->load += shares - g->shares;
+  g->shares = shares;
+  g->quota = quota ? us2cyc(quota) : 0;
+  g->period = us2cyc(period);
+  g->start = rdtsc();
+  g->runtime = 0;
+  release(&grouplock);
+  return 0;
+}
+
+// Free g if it has no processes or child groups, as a group
+// made and never joined would otherwise be kept forever.
+// Returns -1 if g is not in use, is the root, or is not empty.
+int
+groupfree(struct group *g)
+{
+  acquire(&grouplock);
+  if(!g->inuse || g->parent == 0 || g->nproc > 0 || g->nchild > 0){
+    release(&grouplock);
+    return -1;
+  }
+  g->inuse = 0;
+  g->parent->nchild--;
+  release(&grouplock);
+  return 0;
+}
+
+// Start g's next period if the current one is over.
+static void
+grouproll(struct group *g, uint64 now)
+{
+  if(now - g->start >= g->period){
+    g->start = now;
+    g->runtime = 0;
+  }
+}
+
+// Charge the time p has run since the last call
+// to its group and the groups above it.
+static void
+groupcharge1(struct proc *p)
+{
+  struct group *g;
+  uint64 rtime = p->rtime, now = rdtsc(), ran;
+
+  if(p->state == RUNNING)
+    rtime += now - p->stamp;
+  ran = rtime - p->gcharged;
+  p->gcharged = rtime;
+  for(g = p->group; g != 0; g = g->parent){
+    grouproll(g, now);
+    g->runtime += ran;
+    g->usage += ran;
+  }
+}
+
+void
+groupcharge(struct proc *p)
+{
+  acquire(&grouplock);
+  groupcharge1(p);
+  release(&grouplock);
+}
+
+// The cycles run by g and its descendants, read under grouplock
+// since other CPUs may be charging them.
+uint64
+groupusage(struct group *g)
+{
+  uint64 usage;
+
+  acquire(&grouplock);
+  usage = g->usage;
+  release(&grouplock);
+  return usage;
+}
+
+// Whether g or a group above it has used up its quota.
+int
+groupthrottled(struct group *g)
+{
+  uint64 now = rdtsc();
+  int throttled = 0;
+
+  acquire(&grouplock);
+  for(; g != 0 && !throttled; g = g->parent){
+    if(g->quota == 0)
+      continue;
+    grouproll(g, now);
+    throttled = g->runtime >= g->quota;
+  }
+  release(&grouplock);
+  return throttled;
+}
+
+// Scale weight w of a process in group g by g's shares over
+// g's own load, the weight of what is active in g, and so on
+// up to the root.
+uint
+groupweight(struct group *g, uint w)
+{
+  uint64 weight = w;
+
+  acquire(&grouplock);
+  for(; g != 0 && g->parent != 0; g = g->parent)
+    weight = div64(weight * g->shares, g->load ? g->load : 1);
+  release(&grouplock);
+  return weight ? weight : 1;
+}
@@ -0,0 +1,36 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Run a command in a new CPU group, a child of ours, with the
+// given shares and quota_us of CPU time in every period_us.
+int
+main(int argc, char **argv)
+{
+    int gid;
+
+    if(argc < 5) {
+        printf(2, "usage: grouprun shares quota_us period_us cmd [args] (quota 0 for none)\n");
+        exit();
+    }
+
+    if((gid = mkgroup(-1)) < 0) {
+        printf(2, "grouprun: mkgroup failed\n");
+        exit();
+    }
+
+    // Join it first, so that it is freed when we exit on failure.
+    if(setgroup(0, gid) < 0) {
+        groupctl(gid, 0, 0, 0);
+        printf(2, "grouprun: setgroup failed\n");
+        exit();
+    }
+    if(groupctl(gid, atoi(argv[1]), atoi(argv[2]), atoi(argv[3])) < 0) {
+        printf(2, "grouprun: groupctl failed\n");
+        exit();
+    }
+
+    exec(argv[4], argv + 4);
+    printf(2, "grouprun: exec %s failed\n", argv[4]);
+    exit();
+}
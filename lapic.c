@@ -10,6 +10,8 @@
 #include "mmu.h"
 #include "x86.h"
 
+static uint ticr;  // timer count for HZ interrupts per second
+
 // Local APIC registers, divided by 4 for use as uint[] indices.
 #define ID      (0x0020/4)   // ID
 #define VER     (0x0030/4)   // Version
@@ -51,6 +53,21 @@ lapicw(int index, int value)
   lapic[ID];  // wait for write to finish, by reading
 }
 
+static uint
+timercalibrate(void)
+{
+  uint64 t0;
+
+  if(tsckhz == 0)
+    return 10000000;
+  lapicw(TIMER, MASKED);
+  lapicw(TICR, 0xFFFFFFFF);
+  t0 = rdtsc();
+  while(rdtsc() - t0 < (uint64)tsckhz * (1000/HZ))
+    ;
+  return 0xFFFFFFFF - lapic[TCCR];
+}
+
 void
 lapicinit(void)
 {
@@ -62,11 +79,13 @@ lapicinit(void)
 
   // The timer repeatedly counts down at bus frequency
   // from lapic[TICR] and then issues an interrupt.
-  // If xv6 cared more about precise timekeeping,
-  // TICR would be calibrated using an external time source.
+  // The bus frequency is unknown, so the first CPU here
+  // sees how far the timer counts in 1/HZ seconds of TSC.
   lapicw(TDCR, X1);
+  if(ticr == 0)
+    ticr = timercalibrate();
   lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  lapicw(TICR, ticr);
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -40,6 +40,7 @@ void rinode(uint inum, struct dinode *ip);
 void rsect(uint sec, void *buf);
 uint ialloc(ushort type);
 void iappend(uint inum, void *p, int n);
+void dxappend(uint inum, uint parent, struct dirent *de, int n);
 
 // convert to intel byte order
 ushort
@@ -67,11 +68,10 @@ xint(uint x)
 int
 main(int argc, char *argv[])
 {
-  int i, cc, fd;
-  uint rootino, inum, off;
-  struct dirent de;
+  int i, cc, fd, nde;
+  uint rootino, inum;
+  struct dirent *de;
   char buf[BSIZE];
-  struct dinode din;
 
 
   static_assert(sizeof(int) == 4, "Integers must be 4 bytes!");
@@ -83,6 +83,7 @@ main(int argc, char *argv[])
 
   assert((BSIZE % sizeof(struct dinode)) == 0);
   assert((BSIZE % sizeof(struct dirent)) == 0);
+  assert(sizeof(struct dxroot) == BSIZE);
 
   fsfd = open(argv[1], O_RDWR|O_CREAT|O_TRUNC, 0666);
   if(fsfd < 0){
@@ -117,15 +118,8 @@ main(int argc, char *argv[])
   rootino = ialloc(T_DIR);
   assert(rootino == ROOTINO);
 
-  bzero(&de, sizeof(de));
-  de.inum = xshort(rootino);
-  strcpy(de.name, ".");
-  iappend(rootino, &de, sizeof(de));
-
-  bzero(&de, sizeof(de));
-  de.inum = xshort(rootino);
-  strcpy(de.name, "..");
-  iappend(rootino, &de, sizeof(de));
+  de = calloc(argc, sizeof(struct dirent));
+  nde = 0;
 
   for(i = 2; i < argc; i++){
     assert(index(argv[i], '/') == 0);
@@ -144,10 +138,9 @@ main(int argc, char *argv[])
 
     inum = ialloc(T_FILE);
 
-    bzero(&de, sizeof(de));
-    de.inum = xshort(inum);
-    strncpy(de.name, argv[i], DIRSIZ);
-    iappend(rootino, &de, sizeof(de));
+    de[nde].inum = xshort(inum);
+    strncpy(de[nde].name, argv[i], DIRSIZ);
+    nde++;
 
     while((cc = read(fd, buf, sizeof(buf))) > 0)
       iappend(inum, buf, cc);
@@ -155,12 +148,7 @@ main(int argc, char *argv[])
     close(fd);
   }
 
-  // fix size of root inode dir
-  rinode(rootino, &din);
-  off = xint(din.size);
-  off = ((off/BSIZE) + 1) * BSIZE;
-  din.size = xint(off);
-  winode(rootino, &din);
+  dxappend(rootino, rootino, de, nde);
 
   balloc(freeblock);
 
@@ -295,3 +283,81 @@ iappend(uint inum, void *xp, int n)
   din.size = xint(off);
   winode(inum, &din);
 }
+
+// Hash a directory entry name for the directory index.
+// Must agree with dirhash() in fs.c.
+uint
+dirhash(char *name)
+{
+  uint h;
+  int i;
+
+  h = 2166136261;
+  for(i = 0; i < DIRSIZ && name[i]; i++){
+    h ^= (uchar)name[i];
+    h *= 16777619;
+  }
+  return h;
+}
+
+int
+dehashcmp(const void *a, const void *b)
+{
+  uint ha, hb;
+
+  ha = dirhash(((struct dirent*)a)->name);
+  hb = dirhash(((struct dirent*)b)->name);
+  return ha < hb ? -1 : ha > hb;
+}
+
+// Write the n entries in de, plus "." and "..", into the empty
+// directory inum as an indexed directory (see struct dxroot in
+// fs.h). Leaves are filled only halfway so that the kernel
+// can add names for a while before it has to split them.
+void
+dxappend(uint inum, uint parent, struct dirent *de, int n)
+{
+  struct dxroot dx;
+  struct dirent leaf[DPB];
+  struct dinode din;
+  int first[NDXSLOT+1];
+  int i, nleaf;
+
+  qsort(de, n, sizeof(de[0]), dehashcmp);
+
+  bzero(&dx, sizeof(dx));
+  dx.dot.inum = xshort(inum);
+  strcpy(dx.dot.name, ".");
+  dx.dotdot.inum = xshort(parent);
+  strcpy(dx.dotdot.name, "..");
+
+  // Start a new leaf every DPB/2 entries, but never
+  // between two entries with the same hash.
+  nleaf = 0;
+  first[0] = 0;
+  for(i = 0; i < n; i++){
+    if(i == 0 || (i - first[nleaf-1] >= DPB/2 &&
+                  dirhash(de[i].name) != dirhash(de[i-1].name))){
+      assert(nleaf < NDXSLOT);
+      dx.slot[nleaf].block = xshort(nleaf + 1);
+      dx.slot[nleaf].hash = xint(i == 0 ? 0 : dirhash(de[i].name));
+      first[nleaf++] = i;
+    }
+  }
+  if(nleaf == 0)
+    dx.slot[nleaf++].block = xshort(1);
+  first[nleaf] = n;
+  dx.nslot = xshort(nleaf);
+  iappend(inum, &dx, sizeof(dx));
+
+  for(i = 0; i < nleaf; i++){
+    assert(first[i+1] - first[i] <= DPB);
+    bzero(leaf, sizeof(leaf));
+    memmove(leaf, de + first[i], (first[i+1] - first[i]) * sizeof(de[0]));
+    iappend(inum, leaf, sizeof(leaf));
+  }
+
+  rinode(inum, &din);
+  din.major = xshort(DIR_INDEXED);
+  winode(inum, &din);
+}
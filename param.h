@@ -1,4 +1,4 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       512  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
@@ -10,5 +10,11 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define NDENTRY     128  // size of directory name lookup cache
+#define FSSIZE       2000  // size of file system in blocks
+#define NGROUP       16  // maximum number of CPU groups
+#define NOPRIORITY  101  // below every process priority (0-100)
 #define MLFQSIZE     5   // number queues in the MLFQ architecture
+#define HZ          100  // timer interrupts per second
+#define EDFMAXUTIL  950  // thousandths of each CPU deadline processes may reserve
+#define EDFMAXPERIOD 1000000  // longest deadline period, in us
@@ -2,27 +2,35 @@
 #include "defs.h"
 #include "param.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "fs.h"
-#include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "uio.h"
 
-#define PIPESIZE 512
+#define PIPEPAGES 4
+#define PIPESIZE (PIPEPAGES*PGSIZE)
 
+// The ring buffer is made of separately allocated pages so
+// that piperead() and pipegift() can move whole pages between
+// the pipe and user address spaces instead of copying them.
 struct pipe {
   struct spinlock lock;
-  char data[PIPESIZE];
+  char *data[PIPEPAGES];
   uint nread;     // number of bytes read
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
 };
 
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
   struct pipe *p;
+  int i;
 
   p = 0;
   *f0 = *f1 = 0;
@@ -30,6 +38,10 @@ pipealloc(struct file **f0, struct file **f1)
     goto bad;
   if((p = (struct pipe*)kalloc()) == 0)
     goto bad;
+  memset(p->data, 0, sizeof(p->data));
+  for(i = 0; i < PIPEPAGES; i++)
+    if((p->data[i] = kalloc()) == 0)
+      goto bad;
   p->readopen = 1;
   p->writeopen = 1;
   p->nwrite = 0;
@@ -47,8 +59,12 @@ pipealloc(struct file **f0, struct file **f1)
 
 //PAGEBREAK: 20
  bad:
-  if(p)
+  if(p){
+    for(i = 0; i < PIPEPAGES; i++)
+      if(p->data[i])
+        kfree(p->data[i]);
     kfree((char*)p);
+  }
   if(*f0)
     fileclose(*f0);
   if(*f1)
@@ -59,6 +75,8 @@ pipealloc(struct file **f0, struct file **f1)
 void
 pipeclose(struct pipe *p, int writable)
 {
+  int i;
+
   acquire(&p->lock);
   if(writable){
     p->writeopen = 0;
@@ -69,19 +87,28 @@ pipeclose(struct pipe *p, int writable)
   }
   if(p->readopen == 0 && p->writeopen == 0){
     release(&p->lock);
+    for(i = 0; i < PIPEPAGES; i++)
+      kfree(p->data[i]);
     kfree((char*)p);
   } else
     release(&p->lock);
 }
 
 //PAGEBREAK: 40
-int
-pipewrite(struct pipe *p, char *addr, int n)
+// Copy n bytes from addr into the pipe, a contiguous run
+// at a time. If gift is set and a run covers a whole page
+// of the ring and a whole page-aligned page of the caller,
+// the caller's page moves into the ring and the caller is
+// given the ring's old page, zeroed, in its place.
+static int
+pipewrite1(struct pipe *p, char *addr, int n, int gift)
 {
-  int i;
+  int i, m;
+  uint off;
+  char **pg;
 
   acquire(&p->lock);
-  for(i = 0; i < n; i++){
+  for(i = 0; i < n; i += m){
     while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
       if(p->readopen == 0 || myproc()->killed){
         release(&p->lock);
@@ -90,7 +117,16 @@ pipewrite(struct pipe *p, char *addr, int n)
       wakeup(&p->nread);
       sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
     }
-    p->data[p->nwrite++ % PIPESIZE] = addr[i];
+    off = p->nwrite % PGSIZE;
+    pg = &p->data[p->nwrite % PIPESIZE / PGSIZE];
+    m = min(n - i, PGSIZE - off);
+    m = min(m, p->nread + PIPESIZE - p->nwrite);
+    if(!gift || m != PGSIZE || (uint)(addr + i) % PGSIZE != 0 ||
+       swapupage(myproc()->pgdir, addr + i, pg) < 0)
+      memmove(*pg + off, addr + i, m);
+    else
+      memset(addr + i, 0, PGSIZE);
+    p->nwrite += m;
   }
   wakeup(&p->nread);  //DOC: pipewrite-wakeup1
   release(&p->lock);
@@ -98,9 +134,31 @@ pipewrite(struct pipe *p, char *addr, int n)
 }
 
 int
-piperead(struct pipe *p, char *addr, int n)
+pipewrite(struct pipe *p, char *addr, int n)
 {
-  int i;
+  return pipewrite1(p, addr, n, 0);
+}
+
+// Like pipewrite, but moves whole pages instead of
+// copying them where the alignment allows, which
+// leaves those pages of addr zeroed.
+int
+pipegift(struct pipe *p, char *addr, int n)
+{
+  return pipewrite1(p, addr, n, 1);
+}
+
+// Read into the buffers in iov, a contiguous run at a time,
+// waiting only until the pipe is non-empty and stopping once
+// it is drained. A run that is a whole page of the ring and
+// lands on a whole page-aligned page of the caller is moved
+// by swapping pages rather than copied.
+int
+pipereadv(struct pipe *p, struct iovec *iov, int cnt)
+{
+  int i, m, tot;
+  uint off;
+  char **pg, *addr;
 
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
@@ -110,12 +168,32 @@ piperead(struct pipe *p, char *addr, int n)
     }
     sleep(&p->nread, &p->lock); //DOC: piperead-sleep
   }
-  for(i = 0; i < n; i++){  //DOC: piperead-copy
-    if(p->nread == p->nwrite)
-      break;
-    addr[i] = p->data[p->nread++ % PIPESIZE];
+  tot = 0;
+  for(; cnt > 0 && p->nread != p->nwrite; iov++, cnt--){
+    addr = iov->iov_base;
+    for(i = 0; i < iov->iov_len && p->nread != p->nwrite; i += m){  //DOC: piperead-copy
+      off = p->nread % PGSIZE;
+      pg = &p->data[p->nread % PIPESIZE / PGSIZE];
+      m = min(iov->iov_len - i, PGSIZE - off);
+      m = min(m, p->nwrite - p->nread);
+      if(m != PGSIZE || (uint)(addr + i) % PGSIZE != 0 ||
+         swapupage(myproc()->pgdir, addr + i, pg) < 0)
+        memmove(addr + i, *pg + off, m);
+      p->nread += m;
+    }
+    tot += i;
   }
   wakeup(&p->nwrite);  //DOC: piperead-wakeup
   release(&p->lock);
-  return i;
+  return tot;
+}
+
+int
+piperead(struct pipe *p, char *addr, int n)
+{
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return pipereadv(p, &iov, 1);
 }
@@ -0,0 +1,101 @@
+// Pipe throughput benchmark.
+// A child streams TOTAL bytes through a pipe to its parent,
+// once for each way of writing and reading, and the parent
+// reports how many ticks each run took.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSIZE 4096
+#define TOTAL (4*1024*1024)
+
+enum { SMALL, PAGE, GIFT };
+char *modes[] = {
+  [SMALL] "512-byte write/read",
+  [PAGE]  "page write/read",
+  [GIFT]  "page vmsplice/read",
+};
+
+// Return a page-aligned buffer of n bytes.
+char*
+pagealloc(int n)
+{
+  char *p;
+
+  p = sbrk(n + PGSIZE);
+  if(p == (char*)-1){
+    printf(2, "pipebench: sbrk failed\n");
+    exit();
+  }
+  return (char*)(((uint)p + PGSIZE - 1) & ~(PGSIZE - 1));
+}
+
+void
+run(int mode, char *buf)
+{
+  int fds[2], pid, chunk, n, i, tot, t0, t1;
+
+  chunk = mode == SMALL ? 512 : PGSIZE;
+  if(pipe(fds) != 0){
+    printf(2, "pipebench: pipe failed\n");
+    exit();
+  }
+
+  t0 = uptime();
+  pid = fork();
+  if(pid < 0){
+    printf(2, "pipebench: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    close(fds[0]);
+    for(tot = 0; tot < TOTAL; tot += chunk){
+      // vmsplice leaves the page zeroed, so refill it each time.
+      for(i = 0; i < chunk; i += 512)
+        *(int*)(buf + i) = tot + i;
+      if(mode == GIFT)
+        n = vmsplice(fds[1], buf, chunk);
+      else
+        n = write(fds[1], buf, chunk);
+      if(n != chunk){
+        printf(2, "pipebench: write failed\n");
+        exit();
+      }
+    }
+    exit();
+  }
+
+  close(fds[1]);
+  tot = 0;
+  while((n = read(fds[0], buf, chunk)) > 0){
+    for(i = 0; i + 4 <= n; i += 512){
+      if(*(int*)(buf + i) != tot + i){
+        printf(2, "pipebench: %s: wrong data at %d\n", modes[mode], tot + i);
+        exit();
+      }
+    }
+    tot += n;
+  }
+  close(fds[0]);
+  wait();
+  t1 = uptime();
+
+  if(tot != TOTAL){
+    printf(2, "pipebench: %s: read %d of %d bytes\n", modes[mode], tot, TOTAL);
+    exit();
+  }
+  printf(1, "%s: %d KB in %d ticks\n", modes[mode], TOTAL / 1024, t1 - t0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *buf;
+
+  buf = pagealloc(PGSIZE);
+  run(SMALL, buf);
+  run(PAGE, buf);
+  run(GIFT, buf);
+  exit();
+}
@@ -4,15 +4,69 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
-#include "proc.h"
 #include "spinlock.h"
-
+#include "proc.h"
+#include "sleeplock.h"
+#include "vdso.h"
+#include "sched.h"
+
+#define NPIDHASH  64  // chains in the pid hash table
+#define NCHANHASH 64  // chains in the sleeping processes' hash table
+
+// Locking. There is no one lock for all the processes.
+//
+//   ptable.lock     the lists and pid hash table below, nextpid,
+//                   and every process's parent, children and
+//                   sibling; wait() sleeps holding it
+//   sleepq[i].lock  the processes sleeping on channels hashed
+//                   to i, and their chan
+//   p->lock         p's going to sleep, waking and exiting,
+//                   killed, and its scheduling parameters:
+//                   policy, priority, tickets, affinity, group
+//   rq->lock        one CPU's run queues, the processes on them
+//                   and the one it is running; see sched.c
+//   c->timerlock    the processes in sleep(n) on CPU c
+//   grouplock       the CPU groups; see group.c
+//
+// A CPU that holds more than one takes them in this order:
+//
+//   ptable.lock, the lock passed to sleep() (timerlock is one),
+//   sleepq[i].lock, p->lock, rq->lock, grouplock
+//
+// and never holds two of the same kind, so that no two CPUs can
+// each wait for a lock the other holds. Sleeping and waking on
+// different channels, and scheduling on different CPUs, take
+// different locks and so proceed in parallel.
+//
+// A process gives up its CPU by calling sched() holding that
+// CPU's run queue lock, which the scheduler then holds while it
+// picks the next process and switches to it, and which that
+// process releases. A process that goes to sleep or exits
+// also holds its own lock, which the scheduler releases only
+// once it has switched away from the process's stack and
+// address space, so that no other CPU can run it or free it
+// before then.
+
+// Processes are carved out of pages from kalloc(), which are
+// never given back, so a pointer to a struct proc stays valid
+// after the process is freed. UNUSED ones are kept on a free
+// list and the others on a list of all processes, and hashed by
+// pid.
 struct {
   struct spinlock lock;
-  struct proc proc[NPROC];
+  int nproc;                         // Processes not UNUSED
+  struct proc *free;                 // UNUSED processes, through next
+  struct proc *procs;                // The others, oldest first, through
+  struct proc *last;                 // next and prev, and the newest
+  struct proc *pids[NPIDHASH];       // Through hnext
 } ptable;
 
-Queue queues[MLFQSIZE];
+// SLEEPING processes, hashed by the channel they sleep on, so
+// that wakeup() looks only at those that might match.
+struct sleepq {
+  struct spinlock lock;
+  struct proc *head;                 // Through snext and sprev
+} sleepq[NCHANHASH];
 
 static struct proc *initproc;
 
@@ -20,25 +74,15 @@ int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
+static void timerexpire(struct cpu *c);
 
 void
 pinit(void)
 {
   initlock(&ptable.lock, "ptable");
-
-  #ifdef MLFQ
-    // Initializes all the queues
-
-    acquire(&ptable.lock);
-
-    int id_count = 0;
-    for (int i = 0; i < MLFQSIZE; i++) {
-      queues[i].rear = queues[i].front = -1;
-      queues[i].queue_id = id_count++;
-    }
-    release(&ptable.lock);
-  #endif
+  for(int i = 0; i < NCHANHASH; i++)
+    initlock(&sleepq[i].lock, "sleepq");
+  schedinit();
 }
 
 // Must be called with interrupts disabled
@@ -48,41 +92,187 @@ cpuid() {
 }
 
 // Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
+// rescheduled to another CPU while using the result.
 struct cpu*
 mycpu(void)
 {
-  int apicid, i;
-  
+  struct cpu *c;
+
   if(readeflags()&FL_IF)
     panic("mycpu called with interrupts enabled\n");
-  
-  apicid = lapicid();
-  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-  // a reverse map, or reserve a register to store &cpus[i].
-  for (i = 0; i < ncpu; ++i) {
-    if (cpus[i].apicid == apicid)
-      return &cpus[i];
-  }
-  panic("unknown apicid\n");
+  asm volatile("movl %%gs:0, %0" : "=r" (c));
+  return c;
 }
 
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
+// A single load from %gs cannot be split by an interrupt,
+// so there is no need to disable interrupts here: even if
+// we are rescheduled right after, the process is the same.
 struct proc*
 myproc(void) {
-  struct cpu *c;
   struct proc *p;
+
+  asm volatile("movl %%gs:4, %0" : "=r" (p));
+  return p;
+}
+
+static struct proc**
+pidhash(int pid)
+{
+  return &ptable.pids[(uint)pid % NPIDHASH];
+}
+
+static struct sleepq*
+chanhash(void *chan)
+{
+  return &sleepq[((uint)chan * 2654435761U >> 16) % NCHANHASH];
+}
+
+// Find the process with the given pid, which may be a ZOMBIE
+// but not one fork() is still making. Caller must hold
+// ptable.lock, which keeps it from being freed.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = *pidhash(pid); p != 0; p = p->hnext)
+    if(p->pid == pid)
+      return p->state == EMBRYO ? 0 : p;
+  return 0;
+}
+
+// Lock the run queues of the CPU we are running on.
+static void
+lockrq(void)
+{
   pushcli();
-  c = mycpu();
-  p = c->proc;
+  acquire(&mycpu()->rq.lock);
   popcli();
-  return p;
+}
+
+// Unlock them, which may be another CPU's than the one locked
+// before a call to sched(): then they are those the scheduler
+// locked before switching back to this process.
+static void
+unlockrq(void)
+{
+  release(&mycpu()->rq.lock);
+}
+
+// Change p's state, charging the time since its last
+// change of state to the state it is leaving, and putting
+// p on a CPU's run queues if it is becoming RUNNABLE. Caller
+// must hold the lock of p's run queues, to go between RUNNING
+// and RUNNABLE, p->lock, to go to or from SLEEPING or EMBRYO,
+// or both, to go to SLEEPING or ZOMBIE.
+static void
+setstate(struct proc *p, enum procstate state)
+{
+  uint64 now;
+  enum procstate old;
+
+  now = rdtsc();
+  old = p->state;
+  if(old == RUNNING)
+    p->rtime += now - p->stamp;
+  else if(old == RUNNABLE)
+    p->wtime += now - p->stamp;
+  else if(old == SLEEPING)
+    p->iotime += now - p->stamp;
+  p->stamp = now;
+  p->state = state;
+  if(old == RUNNING)
+    groupcharge(p);
+
+  // Its group counts it as active while RUNNABLE or RUNNING.
+  if(p->group && (old == RUNNABLE || old == RUNNING) !=
+     (state == RUNNABLE || state == RUNNING))
+    groupactive(p, state == RUNNABLE || state == RUNNING);
+
+  if(state == RUNNABLE && old == RUNNING)
+    schedenqueue(p);
+  else if(state == RUNNABLE)
+    schedwake(p, old);
+}
+
+// Move p to scheduling class sc, carrying it over
+// to sc's run queue if it is RUNNABLE.
+// Caller must hold p->lock.
+static void
+setclass(struct proc *p, struct sched_class *sc)
+{
+  struct rq *rq = schedlock(p);
+
+  p->sched = sc;
+  p->vcharged = p->rtime;  // not charged for time run under the old class
+  schedunlock(p, rq);
+}
+
+// Put a fresh page's worth of procs on the free list.
+// Returns 0 if out of memory.
+// Caller must hold ptable.lock.
+static int
+procgrow(void)
+{
+  struct proc *p;
+  char *page;
+
+  if((page = kalloc()) == 0)
+    return 0;
+  memset(page, 0, PGSIZE);
+  for(p = (struct proc*)page; (char*)(p + 1) <= page + PGSIZE; p++){
+    initlock(&p->lock, "proc");
+    p->next = ptable.free;
+    ptable.free = p;
+  }
+  return 1;
+}
+
+// Free p and what it owns, and put it back on the free list.
+// Caller must hold ptable.lock.
+static void
+freeproc(struct proc *p)
+{
+  struct proc **pp;
+
+  if(p->kstack)
+    kfree(p->kstack);
+  p->kstack = 0;
+  if(p->vproc)
+    kfree((char*)p->vproc);
+  p->vproc = 0;
+  if(p->pgdir)
+    freevm(p->pgdir);
+  p->pgdir = 0;
+  if(p->group)
+    groupjoin(p, 0);
+
+  for(pp = pidhash(p->pid); *pp != p; pp = &(*pp)->hnext)
+    ;
+  *pp = p->hnext;
+  if(p->prev)
+    p->prev->next = p->next;
+  else
+    ptable.procs = p->next;
+  if(p->next)
+    p->next->prev = p->prev;
+  else
+    ptable.last = p->prev;
+  ptable.nproc--;
+
+  p->pid = 0;
+  p->parent = 0;
+  p->sibling = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+  p->next = ptable.free;
+  ptable.free = p;
 }
 
 //PAGEBREAK: 32
-// Look in the process table for an UNUSED proc.
-// If found, change state to EMBRYO and initialize
+// Take an UNUSED proc off the free list, growing it if it is
+// empty. If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
 // Otherwise return 0.
 static struct proc*
@@ -93,24 +283,47 @@ allocproc(void)
 
   acquire(&ptable.lock);
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-
-  release(&ptable.lock);
-  return 0;
+  if(ptable.nproc >= NPROC || (ptable.free == 0 && !procgrow())){
+    release(&ptable.lock);
+    return 0;
+  }
+  p = ptable.free;
+  ptable.free = p->next;
+  p->next = 0;
+  p->prev = ptable.last;
+  if(p->prev)
+    p->prev->next = p;
+  else
+    ptable.procs = p;
+  ptable.last = p;
+  ptable.nproc++;
 
-found:
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->hnext = *pidhash(p->pid);
+  *pidhash(p->pid) = p;
+  p->sched = sched_classes[defpolicy];
+  p->group = 0;
+  p->gcharged = 0;
+  p->rq = 0;
+  p->migrating = 0;
+  p->cpu = -1;
+  p->affinity = ~0;
+  p->migrations = 0;
+  p->cur_queue = 0;
 
   release(&ptable.lock);
 
-  // Allocate kernel stack.
-  if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+  // Allocate kernel stack, and the page the process sees at VPROC.
+  if((p->kstack = kalloc()) == 0 ||
+     (p->vproc = (struct vproc*)kalloc()) == 0){
+    acquire(&ptable.lock);
+    freeproc(p);
+    release(&ptable.lock);
     return 0;
   }
+  memset(p->vproc, 0, PGSIZE);
+  p->vproc->pid = p->pid;
   sp = p->kstack + KSTACKSIZE;
 
   // Leave room for trap frame.
@@ -140,7 +353,11 @@ found:
   p->n_shed = 0;
   p->punish = 0;
   p->time_slices = 0;
-  p->mlfq_wtime = 0;
+  p->mlfq_stamp = 0;
+  p->vruntime = 0;
+  p->vcharged = 0;
+  p->tickets = DEFTICKETS;
+  p->pass = 0;
 
   for (int i = 0; i < MLFQSIZE; i++)
     p->queue_ticks[i] = 0;
@@ -150,6 +367,8 @@ found:
     p->priority = 1;
   else
     p->priority = 60;
+  p->basepriority = p->priority;
+  p->locks = 0;
   release(&ptable.lock);
 
   return p;
@@ -166,7 +385,7 @@ userinit(void)
   p = allocproc();
   
   initproc = p;
-  if((p->pgdir = setupkvm()) == 0)
+  if((p->pgdir = setupkvm()) == 0 || mapvdso(p->pgdir, (char*)p->vproc) < 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
   p->sz = PGSIZE;
@@ -186,32 +405,14 @@ userinit(void)
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
+  acquire(&p->lock);
 
-  p->state = RUNNABLE;
+  groupjoin(p, &groups[0]);
+  setstate(p, RUNNABLE);
 
-  release(&ptable.lock);
+  release(&p->lock);
 
-  #ifdef RR
-    cprintf("\n\nUsing standard round-robin scheduler\n\n");
-  #else
-  #ifdef FCFS
-    cprintf("\n\nUsing FCFS scheduler\n\n");
-  #else
-  #ifdef PBS
-    cprintf("\n\nUsing Priority based Scheduler\n\n");
-  #else
-  #ifdef MLFQ
-    acquire(&ptable.lock);
-    push(&queues[0], p);
-    p->cur_queue = 0;
-    release(&ptable.lock);
-    // display(&queues[0]);
-    cprintf("\n\nUsing Multi-level Feedback Queue Scheduler\n\n");
-  #endif
-  #endif
-  #endif
-  #endif
+  cprintf("\n\nUsing %s scheduler\n\n", p->sched->name);
 }
 
 // Grow current process's memory by n bytes.
@@ -231,7 +432,6 @@ growproc(int n)
       return -1;
   }
   curproc->sz = sz;
-  switchuvm(curproc);
   return 0;
 }
 
@@ -244,6 +444,9 @@ fork(void)
   int i, pid;
   struct proc *np;
   struct proc *curproc = myproc();
+  struct sched_class *sc;
+  uint affinity;
+  int cpu;
 
   // Allocate process.
   if((np = allocproc()) == 0){
@@ -251,14 +454,14 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
-    kfree(np->kstack);
-    np->kstack = 0;
-    np->state = UNUSED;
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0 ||
+     mapvdso(np->pgdir, (char*)np->vproc) < 0){
+    acquire(&ptable.lock);
+    freeproc(np);
+    release(&ptable.lock);
     return -1;
   }
   np->sz = curproc->sz;
-  np->parent = curproc;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -273,19 +476,33 @@ fork(void)
 
   pid = np->pid;
 
-  acquire(&ptable.lock);
-
-  np->state = RUNNABLE;
+  // The child inherits the parent's scheduling class, but
+  // not a deadline reservation, which would double it.
+  acquire(&curproc->lock);
+  if(curproc->sched->policy == SCHED_EDF)
+    sc = sched_classes[defpolicy];
+  else
+    sc = curproc->sched;
+  // And its CPU affinity, and starts on its parent's CPU
+  // if that is not too busy.
+  affinity = curproc->affinity;
+  cpu = curproc->cpu;
+  // And its CPU group.
+  groupjoin(np, curproc->group);
+  release(&curproc->lock);
 
+  acquire(&ptable.lock);
+  np->parent = curproc;
+  np->sibling = curproc->children;
+  curproc->children = np;
   release(&ptable.lock);
 
-  #ifdef MLFQ
-    acquire(&ptable.lock);
-    push(&queues[0], np);
-    np->cur_queue = 0;
-    release(&ptable.lock);
-    // display(&queues[0]);
-  #endif
+  acquire(&np->lock);
+  np->sched = sc;
+  np->affinity = affinity;
+  np->cpu = cpu;
+  setstate(np, RUNNABLE);
+  release(&np->lock);
 
   return pid;
 }
@@ -298,7 +515,7 @@ exit(void)
 {
   struct proc *curproc = myproc();
   struct proc *p;
-  int fd;
+  int fd, zombies;
 
   if(curproc == initproc)
     panic("init exiting");
@@ -318,23 +535,37 @@ exit(void)
 
   acquire(&ptable.lock);
 
-  // Parent might be sleeping in wait().
-  wakeup1(curproc->parent);
+  // Parent might be sleeping in wait(). It cannot look
+  // for us before we release ptable.lock.
+  wakeup(curproc->parent);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == curproc){
+  if((p = curproc->children) != 0){
+    zombies = 0;
+    for(;;){
       p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
+      zombies |= p->state == ZOMBIE;
+      if(p->sibling == 0)
+        break;
+      p = p->sibling;
     }
+    p->sibling = initproc->children;
+    initproc->children = curproc->children;
+    curproc->children = 0;
+    if(zombies)
+      wakeup(initproc);
   }
 
-  // Jump into the scheduler, never to return.
-  curproc->state = ZOMBIE;
-
   // Mark the end time of a process
   curproc->etime = ticks;
+
+  // Jump into the scheduler, never to return. Our parent
+  // frees us once it has our lock, which the scheduler
+  // releases when it is done with our stack.
+  acquire(&curproc->lock);
+  lockrq();
+  setstate(curproc, ZOMBIE);
+  release(&ptable.lock);
   // cprintf("Process end time is %d\n", curproc->etime);
   // ps();
   /*for (int i = 0; i < MLFQSIZE; i++)
@@ -350,29 +581,22 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
+  struct proc *p, **pp;
   int havekids, pid;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for exited children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
-      havekids = 1;
+    // Look through our children for exited ones.
+    havekids = curproc->children != 0;
+    for(pp = &curproc->children; (p = *pp) != 0; pp = &p->sibling){
       if(p->state == ZOMBIE){
-        // Found one.
+        *pp = p->sibling;
+        // Found one. Wait for the scheduler to be done with it.
+        acquire(&p->lock);
+        release(&p->lock);
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
+        freeproc(p);
         release(&ptable.lock);
         return pid;
       }
@@ -390,43 +614,44 @@ wait(void)
 }
 
 // Waitx system call and is an exact copy of the wait call
-// Wait for a child process to exit and return its pid.
+// Wait for a child process to exit and return its pid,
+// and the TSC cycles it spent running, waiting and sleeping,
+// and the CPU group it was in and the cycles that group and
+// its descendants have run so far.
 // Return -1 if this process has no children.
 int
-waitx(uint* wtime, uint* rtime)
+waitx(uint64 *rtime, uint64 *wtime, uint64 *iotime, int *group, uint64 *gusage)
 {
-  struct proc *p;
+  struct proc *p, **pp;
   int havekids, pid;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for exited children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
-      havekids = 1;
+    // Look through our children for exited ones.
+    havekids = curproc->children != 0;
+    for(pp = &curproc->children; (p = *pp) != 0; pp = &p->sibling){
       if(p->state == ZOMBIE){
+        *pp = p->sibling;
+        // Wait for the scheduler to be done with it.
+        acquire(&p->lock);
+        release(&p->lock);
+
         // Assign the wait times and run times to the variable provided to us
         /*cprintf(
           "\nProcess started at %d and ran for %d, waited for %d, slept for %d and ended at %d and entered scheduler for %d times with %d cpus\n", 
           p->ctime, p->rtime, p->wtime / ncpu, p->iotime / ncpu, p->etime, p->n_shed, ncpu
         );*/
         // cprintf("This process had priority %d\n", p->priority);
-        *wtime = p->wtime / ncpu;
         *rtime = p->rtime;
+        *wtime = p->wtime;
+        *iotime = p->iotime;
+        *group = p->group - groups;
+        *gusage = groupusage(p->group);
 
         // Found one.
         pid = p->pid;
-        kfree(p->kstack); 
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
+        freeproc(p);
         release(&ptable.lock);
         return pid;
       }
@@ -443,22 +668,59 @@ waitx(uint* wtime, uint* rtime)
   }
 }
 
-// Updates the timing vales for all processes in the proc table
-// for every clock tick - might not be desired
+// Change p's priority, requeueing it if it is RUNNABLE, as
+// PBS keeps its queue in priority order.
+// Caller must hold p->lock.
+static void
+setpriority(struct proc *p, int priority)
+{
+  struct rq *rq = schedlock(p);
+
+  // Its weight in its group's load comes from its priority.
+  if (rq)
+    groupactive(p, 0);
+  p->priority = priority;
+  if (rq)
+    groupactive(p, 1);
+  schedunlock(p, rq);
+}
+
+// Priority inheritance. A process that has to wait for a
+// sleeplock lends its priority to the lock's holder until the
+// holder releases it, so a low priority process holding a lock
+// that a high priority one needs is not kept from running, and
+// from releasing the lock, by processes of priorities between
+// the two. Called by acquiresleep() with lk->lk held.
 void
-update_timing() {
-  acquire(&ptable.lock);
+lockwait(struct sleeplock *lk)
+{
+  struct proc *p = myproc();
 
-  for(struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    if (p->state == RUNNING) p->rtime++;
-    else if (p->state == RUNNABLE) {
-      p->wtime++;
-      p->mlfq_wtime++;
-    }
-    else if (p->state == SLEEPING) p->iotime++;
-  }
+  if (p->priority < lk->waitpri)
+    lk->waitpri = p->priority;
+  acquire(&lk->holder->lock);
+  if (lk->waitpri < lk->holder->priority)
+    setpriority(lk->holder, lk->waitpri);
+  release(&lk->holder->lock);
+}
 
-  release(&ptable.lock);
+// Give p back its own priority, or what it still inherits from
+// waiters for the other locks it holds, after releasing a lock
+// that others were waiting for.
+void
+lockrelease(struct proc *p)
+{
+  struct sleeplock *lk;
+  int priority;
+
+  acquire(&p->lock);
+  priority = p->basepriority;
+  for (lk = p->locks; lk != 0; lk = lk->next)
+    if (lk->waitpri < priority)
+      priority = lk->waitpri;
+  if (priority != p->priority)
+    setpriority(p, priority);
+  release(&p->lock);
 }
 
 // Set process priority
@@ -475,16 +737,19 @@ set_priority(int new_priority, int pid) {
   int old_priority = -1;
 
   acquire(&ptable.lock);
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    if(p->pid == pid) {
-      old_priority = p->priority;
-      p->priority = new_priority;
-      break;
-    }
+  if ((p = findproc(pid)) != 0) {
+    acquire(&p->lock);
+    old_priority = p->basepriority;
+    // Keep any better priority it has inherited until it
+    // releases the lock.
+    if (p->priority == p->basepriority || new_priority < p->priority)
+      setpriority(p, new_priority);
+    p->basepriority = new_priority;
+    release(&p->lock);
   }
   release(&ptable.lock);
 
-  if (old_priority == -1 || p->priority != new_priority) 
+  if (old_priority == -1)
     return -1;
   
   if (myproc()->pid == pid)
@@ -494,75 +759,251 @@ set_priority(int new_priority, int pid) {
   return old_priority;
 }
 
-// Punisher
-void punisher() {
+// Give process pid a number of tickets, its share of the CPU
+// under the stride and lottery policies. Returns the old number.
+int
+settickets(int pid, int tickets)
+{
+  struct proc *p;
+  struct rq *rq;
+  int old;
+
+  if(tickets < 1 || tickets > MAXTICKETS)
+    return -1;
+
   acquire(&ptable.lock);
-  myproc()->punish = 1;
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  old = p->tickets;
+  // Requeue it, as the run queues count its tickets.
+  rq = schedlock(p);
+  p->tickets = tickets;
+  schedunlock(p, rq);
+  release(&p->lock);
   release(&ptable.lock);
+  return old;
 }
 
-// Increase time slice of process
-void inc_timeslice() {
+// Let process pid, or the calling process if pid is 0, run
+// only on the CPUs in mask, bit i standing for CPU i. Bits for
+// CPUs that are not there are ignored. A RUNNABLE process moves
+// to one of those CPUs at once and a RUNNING one at its next
+// tick. Returns the old mask.
+int
+setaffinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct rq *rq;
+  uint all, old;
+
+  all = (1 << ncpu) - 1;
+  mask &= all;
+  if(mask == 0)
+    return -1;
+  if(pid == 0)
+    pid = myproc()->pid;
+
   acquire(&ptable.lock);
-  myproc()->time_slices++;
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  old = p->affinity & all;
+  rq = schedlock(p);
+  p->affinity = mask;
+  schedunlock(p, rq);
+  release(&p->lock);
   release(&ptable.lock);
+  return old;
 }
 
-// Process Ager - this basically looks at all the processes and ages them accordingly.
-int age_processes(int queue_id) {
-  // cprintf("We are ageing the queue %d\n", queue_id);
-  if (queues[queue_id].front == -1 && queues[queue_id].rear == -1) return 1;
+// Set how many ticks an MLFQ process waits in a queue
+// before it moves up one. Returns the old number.
+int
+setagethres(int n)
+{
+  int old;
+
+  if(n < 1)
+    return -1;
+  old = agethres;
+  agethres = n;
+  return old;
+}
+
+// Make a CPU group under group parent, or with parent -1
+// under the calling process's group. Returns its number.
+int
+mkgroup(int parent)
+{
+  struct proc *p = myproc();
+  struct group *g;
+
+  if(parent == -1){
+    acquire(&p->lock);
+    g = groupalloc(p->group);
+    release(&p->lock);
+  } else if(parent >= 0 && parent < NGROUP)
+    g = groupalloc(&groups[parent]);
+  else
+    g = 0;
+  return g ? g - groups : -1;
+}
+
+// Move process pid, or the calling process if pid is 0,
+// into CPU group gid. Returns its old group.
+int
+setgroup(int pid, int gid)
+{
+  struct proc *p;
+  struct rq *rq;
+  int old;
+
+  if(gid < 0 || gid >= NGROUP)
+    return -1;
+  if(pid == 0)
+    pid = myproc()->pid;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  old = p->group - groups;
+  if(p->state == ZOMBIE)
+    old = -1;
   else {
-    // Code for ageing here.
-    int front_pos = queues[queue_id].front;
-    int rear_pos = queues[queue_id].rear;
+    // Requeue it, as its CFS weight depends on its group.
+    rq = schedlock(p);
+    if(groupjoin(p, &groups[gid]) < 0)
+      old = -1;
+    schedunlock(p, rq);
+  }
+  release(&p->lock);
+  release(&ptable.lock);
+  return old;
+}
 
-    struct proc* p;
+// Give CPU group gid shares of its parent's CPU time, and
+// limit it to quota us of CPU time in every period us, or
+// not at all if quota is 0. The root group cannot be limited.
+// With shares 0, delete gid instead, if it is empty.
+int
+groupctl(int gid, int shares, int quota, int period)
+{
+  if(gid > 0 && gid < NGROUP && shares == 0)
+    return groupfree(&groups[gid]);
+  if(gid <= 0 || gid >= NGROUP || shares < 1 || shares > MAXSHARES ||
+     quota < 0 || period < 1000 || period > 1000000)
+    return -1;
 
-    if (front_pos == -1 || rear_pos == -1) {
-        return -1;
-    }
-    // cprintf("we have %d -- %d\n", front_pos, rear_pos);
-
-    if (front_pos <= rear_pos) {
-      while(front_pos <= rear_pos) {
-        front_pos++;
-        p = pop(&queues[queue_id]);
-        if (p == 0) continue;
-        if (p->mlfq_wtime / NCPU > AGE_THRES && p->cur_queue != 0) {
-          p->cur_queue--;
-          p->mlfq_wtime = 0;
-          // cprintf("%d moved from %d to %d at %d\n", p->pid, p->cur_queue + 1, p->cur_queue, ticks);
-        }
-        push(&queues[p->cur_queue], p);
-      }
-    }
-    else {
-      while (front_pos <= MLFQSIZE - 1) {
-        front_pos++;
-        p = pop(&queues[queue_id]);
-        if (p == 0) continue;
-        if (p->mlfq_wtime / NCPU > AGE_THRES && p->cur_queue != 0) {
-          p->cur_queue--;
-          p->mlfq_wtime = 0;
-          // cprintf("%d moved from %d to %d at %d\n", p->pid, p->cur_queue + 1, p->cur_queue, ticks);
-        }
-        push(&queues[p->cur_queue], p);
-      }
-      front_pos = 0;
-      while (front_pos <= rear_pos) {
-        front_pos++;
-        p = pop(&queues[queue_id]);
-        if (p == 0) continue;
-        if (p->mlfq_wtime / NCPU > AGE_THRES && p->cur_queue != 0) {
-          p->cur_queue--;
-          p->mlfq_wtime = 0;
-          // cprintf("%d moved from %d to %d at %d\n", p->pid, p->cur_queue + 1, p->cur_queue, ticks);
-        }
-        push(&queues[p->cur_queue], p);
-      }
+  return groupset(&groups[gid], shares, quota, period);
+}
+
+// Move process pid to the scheduling policy given, or if pid
+// is 0, every process, and make it the policy for new ones.
+// Returns the old policy, of the process or the default.
+int
+setsched(int pid, int policy)
+{
+  struct proc *p;
+  struct sched_class *sc;
+  int old = -1;
+
+  // Deadline processes must go through setdeadline().
+  if(policy < 0 || policy >= NSCHED || policy == SCHED_EDF)
+    return -1;
+  sc = sched_classes[policy];
+
+  acquire(&ptable.lock);
+  if(pid == 0){
+    old = defpolicy;
+    defpolicy = policy;
+  }
+  for(p = pid ? findproc(pid) : ptable.procs; p != 0; p = pid ? 0 : p->next){
+    if(p->state == EMBRYO)
+      continue;
+    acquire(&p->lock);
+    if(pid != 0)
+      old = p->sched->policy;
+    setclass(p, sc);
+    release(&p->lock);
+  }
+  release(&ptable.lock);
+
+  return old;
+}
+
+// Make the calling process a deadline process that needs
+// runtime us of CPU time in each period of period us, within
+// deadline us of the period's start. Refused unless the
+// deadline processes' total utilization still fits in
+// EDFMAXUTIL thousandths of each CPU.
+int
+setdeadline(uint runtime, uint deadline, uint period)
+{
+  struct proc *p, *curproc = myproc();
+  uint util, total;
+
+  if(runtime == 0 || runtime > deadline || deadline > period ||
+     period > EDFMAXPERIOD)
+    return -1;
+  util = runtime * 1000 / period;
+
+  acquire(&ptable.lock);
+  total = util;
+  for(p = ptable.procs; p != 0; p = p->next)
+    if(p != curproc && p->state != ZOMBIE &&
+       p->sched->policy == SCHED_EDF)
+      total += p->dl_util;
+  if(total > ncpu * EDFMAXUTIL){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&curproc->lock);
+  curproc->dl_runtime = us2cyc(runtime);
+  curproc->dl_deadline = us2cyc(deadline);
+  curproc->dl_period = us2cyc(period);
+  curproc->dl_util = util;
+  curproc->dl_abs = rdtsc() + curproc->dl_deadline;
+  curproc->dl_budget = curproc->dl_runtime;
+  curproc->dl_misses = 0;
+  setclass(curproc, sched_classes[SCHED_EDF]);
+  release(&curproc->lock);
+  release(&ptable.lock);
+  return 0;
+}
+
+// Called on each timer interrupt, on every CPU, with
+// interrupts off. Wakes the CPU's expired sleepers, keeps its
+// load average and balances load, and gives up the CPU if the
+// running process's scheduling class says it should.
+void
+schedtick(void)
+{
+  struct proc *p = myproc();
+  struct cpu *c = mycpu();
+  int balance;
+
+  timerexpire(c);
+  acquire(&c->rq.lock);
+  balance = schedclock(c);
+  release(&c->rq.lock);
+  if(balance)
+    schedbalance(c, 0);
+
+  if(p && p->state == RUNNING){
+    acquire(&c->rq.lock);
+    if(schedpreempt(p)){
+      setstate(p, RUNNABLE);
+      sched();
     }
-    return 0;
+    unlockrq();
   }
 }
 
@@ -579,132 +1020,80 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int n;
   c->proc = 0;
 
-  #if defined(PBS) || defined(FCFS)
-    struct proc* p1;
-  #endif
-
-  #ifdef MLFQ
-    while (1) {
-      sti();
-
-      acquire(&ptable.lock);
-
-      for (int i = 1; i < MLFQSIZE; i++)
-        age_processes(i);
-      
-      p = 0;
-      for (int i = 0; i < MLFQSIZE; i++) {
-        if (get_size(&queues[i]) == 0) {
-          continue;
-        }
-        p = queues[i].arr[queues[i].front];
-        pop(&queues[i]);
-        break;
-      }
-
-      if (p == 0 || p->state != RUNNABLE) {
-        release(&ptable.lock);
-        continue;
-      }
-
-      // cprintf("Sending process %d to run\n", p->pid);
-
-      p->n_shed++;
-      p->mlfq_wtime = 0;
-
-      // Switch to chosen process. It is the process's job
-      // to release ptable.lock and then reacquire it
-      // before jumping back to us.
-      c->proc = p;
-      switchuvm(p);
-      p->state = RUNNING;
-
-      swtch(&(c->scheduler), p->context);
-      switchkvm();
-
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      c->proc = 0;
+  // Process whose page directory is still loaded in %cr3.
+  // Only trusted while c->rq.lock is held and the process
+  // is on c's run queues, since otherwise it may run, exec
+  // or be freed elsewhere.
+  struct proc *last = 0;
 
-      // Back from p
-      if (p != 0 && p->state == RUNNABLE) {
-        p->queue_ticks[p->cur_queue]++;
-        // cprintf("%d -- %d in trap\n", (1 << p->cur_queue), p->time_slices);
-        if (p->punish == 0) {
-          // p->time_slices = 0;
-          // p->age_time = ticks;
-        } else {
-          p->time_slices = 0;
-          p->punish = 0;
-          // p->age_time = ticks;
-          
-          if (p->cur_queue != MLFQSIZE - 1) {
-            p->cur_queue++;
-            // cprintf("%d moved from %d to %d at %d\n", p->pid, p->cur_queue - 1, p->cur_queue, ticks);
-            // cprintf("Shifted current queue to %d\n", p->cur_queue);
-          }
-        }
-        push(&queues[p->cur_queue], p);
-        /*for (int i = 0; i < MLFQSIZE; i++)
-          display(&queues[i]); 
-        cprintf("\n");*/
-      }
-      release(&ptable.lock);
-    }
-  #else
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if (p->state != RUNNABLE)
-        continue;
-      #ifndef RR
-      struct proc* chosen_proc = p;
-      for (p1 = ptable.proc; p1 < &ptable.proc[NPROC]; p1++) {
-        if (p1->state != RUNNABLE)
-          continue;
-
-        #ifdef FCFS
-        if (p1->ctime < chosen_proc->ctime)
-          chosen_proc = p1; 
-        #else   
-        #ifdef PBS
-        if (p1->priority < chosen_proc->priority)
-          chosen_proc = p1;
-        #endif
-        #endif
-      }
-      p = chosen_proc;
-      #endif
-
+    // Run up to NPROC processes from this CPU's run queues,
+    // chosen by their scheduling classes, before letting
+    // interrupts in again.
+    acquire(&c->rq.lock);
+    for(n = 0; n < NPROC && (p = schedpick(c)) != 0; n++){
       p->n_shed++;
 
       // Switch to chosen process.  It is the process's job
-      // to release ptable.lock and then reacquire it
-      // before jumping back to us.
+      // to release c->rq.lock, and to acquire the run queue
+      // lock of the CPU it is on before jumping back to us.
+      // Go straight from the last process's address space to
+      // this one's; there is no need to reload anything at all
+      // if it is the same process again.
       c->proc = p;
-      switchuvm(p);
-      p->state = RUNNING;
+      vdso->cpu[c-cpus].pid = p->pid;
+      vdso->cpu[c-cpus].nswitch++;
+      if(p != last)
+        switchuvm(p);
+      setstate(p, RUNNING);
 
       swtch(&(c->scheduler), p->context);
-      switchkvm();
+      last = p;
 
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       c->proc = 0;
+      vdso->cpu[c-cpus].pid = 0;
+
+      if(p->state == SLEEPING || p->state == ZOMBIE){
+        // It came holding its own lock, so that it cannot be
+        // woken, or freed, until we are off its stack. Leave its
+        // address space too before letting it go.
+        switchkvm();
+        last = 0;
+        release(&p->lock);
+      } else if((p->affinity & (1 << (c-cpus))) == 0){
+        // Preempted, but no longer allowed to run here;
+        // now that it is switched out it can move.
+        switchkvm();
+        last = 0;
+        scheddetach(p);
+        release(&c->rq.lock);
+        schedwake(p, RUNNABLE);
+        acquire(&c->rq.lock);
+      }
     }
-    release(&ptable.lock);
+    if(last){
+      switchkvm();
+      last = 0;
+    }
+    release(&c->rq.lock);
+
+    // Nothing to run here: take work from a busier CPU.
+    if(n == 0)
+      schedbalance(c, 1);
   }
-  #endif
 }
 
-// Enter scheduler.  Must hold only ptable.lock
-// and have changed proc->state. Saves and restores
+// Enter scheduler.  Must hold only this CPU's run queue lock,
+// and p->lock if going to sleep or exiting, and have changed
+// proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
 // be proc->intena and proc->ncli, but that would
@@ -716,9 +1105,9 @@ sched(void)
   int intena;
   struct proc *p = myproc();
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
-  if(mycpu()->ncli != 1)
+  if(!holding(&mycpu()->rq.lock))
+    panic("sched rq.lock");
+  if(mycpu()->ncli != 1 + holding(&p->lock))
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
@@ -733,10 +1122,10 @@ sched(void)
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
+  lockrq();  //DOC: yieldlock
+  setstate(myproc(), RUNNABLE);
   sched();
-  release(&ptable.lock);
+  unlockrq();
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -745,8 +1134,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding the run queue lock from scheduler.
+  unlockrq();
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -766,6 +1155,7 @@ void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct sleepq *q;
   
   if(p == 0)
     panic("sleep");
@@ -773,60 +1163,120 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
-  // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
-  // Go to sleep.
+  // Must join chan's sleep queue before releasing lk.
+  // Once we hold its lock, we can be guaranteed that
+  // we won't miss any wakeup (wakeup looks for
+  // sleepers with the queue locked), so it's okay to
+  // release lk.
+  q = chanhash(chan);
+  acquire(&q->lock);  //DOC: sleeplock1
+  release(lk);
+
+  // Go to sleep. Holding p->lock keeps a waker from
+  // making us RUNNABLE until the scheduler has switched
+  // away from us, when it releases it.
+  acquire(&p->lock);
   p->chan = chan;
-  p->state = SLEEPING;
-
+  p->sprev = &q->head;
+  p->snext = q->head;
+  if(p->snext)
+    p->snext->sprev = &p->snext;
+  q->head = p;
+  release(&q->lock);
+
+  lockrq();
+  setstate(p, SLEEPING);
   sched();
-
-  // Tidy up.
-  p->chan = 0;
+  unlockrq();
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
+  acquire(lk);  //DOC: sleeplock2
+}
+
+// Sleep for n clock ticks, or until killed. The process goes
+// on the timer list of the CPU it is running on, and that
+// CPU's own timer interrupt wakes it, so that waking
+// sleepers is spread over the CPUs rather than left to CPU 0.
+int
+sleepticks(int n)
+{
+  struct proc *p = myproc(), **pp;
+  struct cpu *c;
+
+  if(n <= 0)
+    return 0;
+
+  pushcli();
+  c = mycpu();
+  acquire(&c->timerlock);
+  popcli();
+  p->wakeat = ticks + n;
+  for(pp = &c->timers; *pp && (int)((*pp)->wakeat - p->wakeat) <= 0; pp = &(*pp)->tnext)
+    ;
+  p->tnext = *pp;
+  *pp = p;
+  p->timercpu = c;
+  while(p->timercpu){
+    if(p->killed){
+      for(pp = &c->timers; *pp != p; pp = &(*pp)->tnext)
+        ;
+      *pp = p->tnext;
+      p->tnext = 0;
+      p->timercpu = 0;
+      release(&c->timerlock);
+      return -1;
+    }
+    sleep(&p->wakeat, &c->timerlock);
   }
+  release(&c->timerlock);
+  return 0;
 }
 
-//PAGEBREAK!
-// Wake up all processes sleeping on chan.
-// The ptable lock must be held.
+// Wake the processes on CPU c's timer list whose time has come.
 static void
-wakeup1(void *chan)
+timerexpire(struct cpu *c)
 {
   struct proc *p;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    if(p->state == SLEEPING && p->chan == chan) {
-      p->state = RUNNABLE;
-
-      #ifdef MLFQ
-        push(&queues[p->cur_queue], p);
-        p->time_slices = 0;
-        // p->age_time = ticks;
-      #endif
-    }
+  acquire(&c->timerlock);
+  while((p = c->timers) != 0 && (int)(ticks - p->wakeat) >= 0){
+    c->timers = p->tnext;
+    p->tnext = 0;
+    p->timercpu = 0;
+    wakeup(&p->wakeat);
   }
+  release(&c->timerlock);
+}
+
+//PAGEBREAK!
+// Wake p, which is on sleep queue q, whose lock
+// the caller holds.
+static void
+wakeup1(struct sleepq *q, struct proc *p)
+{
+  acquire(&p->lock);
+  *p->sprev = p->snext;
+  if(p->snext)
+    p->snext->sprev = p->sprev;
+  p->chan = 0;
+  setstate(p, RUNNABLE);
+  release(&p->lock);
 }
 
 // Wake up all processes sleeping on chan.
 void
 wakeup(void *chan)
 {
-  acquire(&ptable.lock);
-  wakeup1(chan);
-  release(&ptable.lock);
+  struct sleepq *q = chanhash(chan);
+  struct proc *p, *next;
+
+  acquire(&q->lock);
+  for(p = q->head; p != 0; p = next){
+    next = p->snext;
+    if(p->chan == chan)
+      wakeup1(q, p);
+  }
+  release(&q->lock);
 }
 
 // Kill the process with the given pid.
@@ -836,27 +1286,31 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct sleepq *q;
+  void *chan;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING) {
-        p->state = RUNNABLE;
-
-        #ifdef MLFQ
-          push(&queues[p->cur_queue], p);
-          p->time_slices = 0;
-          // p->age_time = ticks;
-        #endif
-      }
-      release(&ptable.lock);
-      return 0;
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  acquire(&p->lock);
+  p->killed = 1;
+  release(&p->lock);
+  // Wake process from sleep if necessary. Its chan can
+  // only change while its sleep queue is unlocked.
+  while((chan = *(void* volatile*)&p->chan) != 0){
+    q = chanhash(chan);
+    acquire(&q->lock);
+    if(p->chan == chan){
+      wakeup1(q, p);
+      release(&q->lock);
+      break;
     }
+    release(&q->lock);
   }
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -879,9 +1333,7 @@ procdump(void)
   char *state;
   uint pc[10];
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == UNUSED)
-      continue;
+  for(p = ptable.procs; p != 0; p = p->next){
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
     else
@@ -902,7 +1354,10 @@ ps(void) {
   struct proc *p;
   sti();
 
-  cprintf("PID \t Prior \t State \t rtime \t wtime \t nruns \t curq \t q0 \t q1 \t q2 \t q3 \t q4\n");
+  struct proc *q;
+  uint total;
+
+  cprintf("PID \t Policy \t Prior \t State \t rtime \t wtime \t nruns \t curq \t q0 \t q1 \t q2 \t q3 \t q4 \t Tix \t Pass \t Share \t Miss \t CPU \t Migr \t Grp\n");
 
   static char *states[] = {
     [EMBRYO]    "EMBRYO",
@@ -911,34 +1366,87 @@ ps(void) {
     [RUNNING]   "RUN",
     [ZOMBIE]    "ZOMB"
   };
+  static char *policies[] = {
+    [SCHED_RR]    "RR",
+    [SCHED_FCFS]  "FCFS",
+    [SCHED_PBS]   "PBS",
+    [SCHED_MLFQ]  "MLFQ",
+    [SCHED_CFS]   "CFS",
+    [SCHED_STRIDE]  "STRIDE",
+    [SCHED_LOTTERY] "LOTTERY",
+    [SCHED_EDF]   "EDF"
+  };
 
   acquire(&ptable.lock);
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-    if (p->state == UNUSED) 
-      continue;
+  for (p = ptable.procs; p != 0; p = p->next) {
+    int mlfq = p->sched->policy == SCHED_MLFQ;
 
-    #ifdef PBS
-      cprintf("%d \t %d \t %s \t", p->pid, p->priority, states[p->state]);
-    #else
-      cprintf("%d \t NO \t %s \t", p->pid, states[p->state]);
-    #endif
+    cprintf("%d \t %s \t", p->pid, policies[p->sched->policy]);
+    if (p->sched->policy == SCHED_PBS || p->sched->policy == SCHED_CFS)
+      cprintf(" %d \t %s \t", p->priority, states[p->state]);
+    else
+      cprintf(" NO \t %s \t", states[p->state]);
 
-    cprintf(" %d \t", p->rtime);
+    cprintf(" %d \t", cyc2ticks(p->rtime));
 
-    #ifdef MLFQ
-      cprintf(" %d \t %d \t %d \t", p->mlfq_wtime / ncpu, p->n_shed, p->cur_queue);
-    #else
-      cprintf(" %d \t %d \t NO \t", p->wtime / ncpu, p->n_shed);
-    #endif
+    if (mlfq)
+      cprintf(" %d \t %d \t %d \t", p->state == RUNNABLE ? ticks - p->mlfq_stamp : 0,
+              p->n_shed, p->cur_queue);
+    else
+      cprintf(" %d \t %d \t NO \t", cyc2ticks(p->wtime), p->n_shed);
 
     for (int i = 0; i < MLFQSIZE; i++) {
-      #ifdef MLFQ
-        cprintf(" %d \t", ((p->queue_ticks[i]-1) < 0?0:(p->queue_ticks[i]-1)));
-      #else
+      if (mlfq)
+        cprintf(" %d \t", p->queue_ticks[i]);
+      else
         cprintf(" NO \t");
-      #endif
     }
-    cprintf("\n");
+
+    // Tickets, and the run time achieved as a percentage of
+    // that of all processes under the same policy.
+    if (p->sched->policy == SCHED_STRIDE || p->sched->policy == SCHED_LOTTERY) {
+      total = 0;
+      for (q = ptable.procs; q != 0; q = q->next)
+        if (q->sched == p->sched)
+          total += cyc2ticks(q->rtime);
+      cprintf(" %d \t", p->tickets);
+      if (p->sched->policy == SCHED_STRIDE)
+        cprintf(" %d \t", (uint)p->pass);
+      else
+        cprintf(" NO \t");
+      cprintf(" %d%% \t", total ? cyc2ticks(p->rtime) * 100 / total : 0);
+    } else
+      cprintf(" NO \t NO \t NO \t");
+
+    if (p->sched->policy == SCHED_EDF)
+      cprintf(" %d \t", p->dl_misses);
+    else
+      cprintf(" NO \t");
+
+    // The CPU it is running on, or last ran on.
+    if (p->cpu >= 0)
+      cprintf(" %d \t %d", p->cpu, p->migrations);
+    else
+      cprintf(" - \t %d", p->migrations);
+    cprintf(" \t %d\n", p->group ? p->group - groups : -1);
+  }
+
+  // CPU groups, with the run time of each and its descendants
+  cprintf("\nGroup \t Parent \t Shares \t Quota \t Period \t Procs \t Active \t rtime\n");
+  for (struct group *g = groups; g < &groups[NGROUP]; g++) {
+    if (!g->inuse)
+      continue;
+    cprintf("%d \t", g - groups);
+    if (g->parent)
+      cprintf(" %d \t %d \t", g->parent - groups, g->shares);
+    else
+      cprintf(" - \t - \t");
+    if (g->quota)
+      cprintf(" %dus \t %dus \t", (uint)div64(g->quota * 1000, tsckhz),
+              (uint)div64(g->period * 1000, tsckhz));
+    else
+      cprintf(" - \t - \t");
+    cprintf(" %d \t %d \t %d\n", g->nproc, g->nactive, cyc2ticks(groupusage(g)));
   }
   release(&ptable.lock);
 
@@ -1,3 +1,63 @@
+// Run queue: a list of RUNNABLE processes threaded
+// through their qnext and qprev fields.
+typedef struct _Queue 
+{ 
+  int queue_id;
+  int size;
+  struct proc *head, *tail;
+} Queue;
+
+// Red-black tree of processes threaded through their rb*
+// fields, kept in the order given by before().
+struct rbtree {
+  struct proc *root;
+  struct proc *first;          // Leftmost process, or 0 if empty
+  int size;
+  int (*before)(struct proc*, struct proc*);
+};
+
+// Group of processes sharing the CPU, see group.c.
+struct group {
+  int inuse;
+  struct group *parent;        // Or 0 for the root group
+  uint shares;                 // Weight among its siblings
+  uint64 quota;                // Cycles it may run per period, or 0
+  uint64 period;               // Cycles
+  uint64 start;                // When the current period began
+  uint64 runtime;              // Cycles run in the current period
+  uint64 usage;                // Cycles run by it and its descendants
+  int nproc;                   // Member processes
+  int nchild;                  // Child groups
+  int nactive;                 // RUNNABLE or RUNNING processes in its subtree
+  uint load;                   // Weight of its active processes and children
+};
+
+extern struct group groups[NGROUP];
+
+// Per-CPU run queues: the queues of every scheduling
+// class for the processes waiting to run on one CPU.
+struct rq {
+  struct spinlock lock;        // Protects all of it, see proc.c
+  int nrunnable;               // Processes on these queues
+  struct proc *tasks;          // List of them, through rqnext
+  uint load;                   // Recent average of nrunnable + running
+  int balticks;                // Ticks since the last periodic balance
+  Queue rr;
+  Queue fcfs;
+  Queue pbs;
+  Queue mlfq[MLFQSIZE];
+  struct rbtree cfs;
+  uint64 min_vruntime;         // Never decreases
+  uint cfsload;                // Total weight of the processes in cfs
+  struct rbtree stride;
+  uint64 global_pass;          // Pass of the last process picked
+  Queue lottery;
+  uint lotterytickets;         // Total tickets in lottery
+  struct rbtree edf;
+  Queue throttled;             // Out of budget until their dl_abs
+  Queue grouphold;             // Groups out of quota until their period ends
+};
+
 // Per-CPU state
 struct cpu {
   uchar apicid;                // Local APIC ID
@@ -7,7 +67,15 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+
+  // Per-CPU variables, reached through %gs (see seginit).
+  // Must stay in this order: self at %gs:0, proc at %gs:4.
+  struct cpu *self;            // This struct cpu
   struct proc *proc;           // The process running on this cpu or null
+
+  struct rq rq;                // Processes waiting to run here
+  struct spinlock timerlock;
+  struct proc *timers;         // Processes in sleep(n) here, soonest first
 };
 
 extern struct cpu cpus[NCPU];
@@ -36,12 +104,16 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
 struct proc {
+  struct spinlock lock;        // See proc.c for what it protects
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
+  struct vproc *vproc;         // Kernel data mapped read-only at VPROC
   enum procstate state;        // Process state
   int pid;                     // Process ID
   struct proc *parent;         // Parent process
+  struct proc *children;       // Its newest child, and through sibling
+  struct proc *sibling;        // the others; next child of parent
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
@@ -49,16 +121,68 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  struct proc *next;           // Next on the free list, or on the list
+  struct proc *prev;           // of all other processes, and previous
+  struct proc *hnext;          // Next in its pid's hash chain
+  struct proc *snext;          // Next in its chan's hash chain, if SLEEPING
+  struct proc **sprev;         // And what points at it there
 
   // Added to keep track of time
   uint ctime; // Process creation time
   uint etime; // Process end time
-  uint rtime; // Process running time
-  uint wtime; // Process waiting time
-  uint iotime; // Process sleeping or I/O time
+  uint64 rtime; // Process running time, in TSC cycles
+  uint64 wtime; // Process waiting time, in TSC cycles
+  uint64 iotime; // Process sleeping or I/O time, in TSC cycles
+  uint64 stamp; // TSC at the last change of state
+
+  // Scheduling class and its run queue, see sched.c
+  struct sched_class *sched;   // Policy that schedules this process
+  struct rq *rq;               // CPU run queues it is, or was last, on
+  int migrating;               // Off them, on its way to another CPU's
+  int cpu;                     // CPU it last ran on, or -1
+  uint affinity;               // Mask of the CPUs it may run on
+  int migrations;              // Times it has run on a different CPU
+  struct proc *rqnext;         // Next and previous on rq->tasks
+  struct proc *rqprev;
+  uint wakeat;                 // Tick to wake at, if on a CPU's timers
+  struct cpu *timercpu;        // And that CPU, or 0
+  struct proc *tnext;          // Next on its timers
+  struct _Queue *queue;        // Run queue this process is on, if RUNNABLE
+  struct proc *qnext;          // Next and previous on that queue
+  struct proc *qprev;
+  struct rbtree *rbtree;       // Or the tree it is in, and its links there
+  struct proc *rbleft;
+  struct proc *rbright;
+  struct proc *rbparent;
+  int rbred;
+
+  // CFS virtual run time: TSC cycles run, scaled by NICE0/weight
+  uint64 vruntime;
+  uint64 vcharged;             // rtime already counted in vruntime or pass
+  uint cfsweight;              // Weight it added to rq->cfsload
+
+  // CPU group
+  struct group *group;
+  uint gweight;                // Weight it added to group->load, if active
+  uint64 gcharged;             // rtime already charged to its groups
+
+  // Stride and lottery scheduling
+  int tickets;                 // Share of the CPU, relative to others
+  uint64 pass;                 // Stride: ms run, scaled by STRIDE1/tickets
+
+  // Earliest deadline first, all in TSC cycles but dl_util
+  uint64 dl_runtime;           // Budget for each period
+  uint64 dl_deadline;          // Relative deadline
+  uint64 dl_period;
+  uint dl_util;                // dl_runtime/dl_period, in thousandths
+  uint64 dl_abs;               // Current absolute deadline
+  uint64 dl_budget;            // What is left of this period's budget
+  int dl_misses;               // Deadlines passed while still running
 
   // Priority for PBS scheduling
   int priority; // Value between 0 and 100. Lower number, higher priority.
+  int basepriority;            // Priority set for it, before any it inherits
+  struct sleeplock *locks;     // Sleeplocks it holds, through next
 
   int n_shed; // Number of time the process is getting scheduled
 
@@ -67,7 +191,7 @@ struct proc {
   int time_slices; // The number of time slices that the process spends in getting scheduled
   int punish;
   int queue_ticks[MLFQSIZE];
-  int mlfq_wtime;
+  uint mlfq_stamp;              // ticks when it joined its MLFQ queue
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -76,15 +200,18 @@ struct proc {
 //   fixed-size stack
 //   expandable heap
 
-
-// Queue Node definition
-typedef struct _Queue 
-{ 
-  int queue_id;
-
-  // Initialize front and rear 
-  int rear, front; 
-
-  // Circular Queue
-  struct proc* arr[NPROC];
-} Queue;
+// A scheduling policy. Each process points at the class that
+// schedules it, and sched.c calls into that class, holding the
+// lock of the run queues concerned, whenever the process's
+// runnability changes. Each function works on one CPU's run
+// queues; wakeup is called holding only p->lock.
+struct sched_class {
+  int policy;                                   // SCHED_* number from sched.h
+  char *name;
+  void (*enqueue)(struct rq*, struct proc*);    // p has become RUNNABLE
+  void (*dequeue)(struct rq*, struct proc*);    // take RUNNABLE p off rq
+  struct proc* (*pick_next)(struct rq*);        // dequeue the next process to run, or 0
+  int (*tick)(struct rq*, struct proc*);        // timer tick while p runs; 1 to preempt
+  void (*yield)(struct rq*, struct proc*);      // running p is RUNNABLE again
+  void (*wakeup)(struct proc*);                 // p is waking from sleep; may be 0
+};
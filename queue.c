@@ -1,113 +1,98 @@
-/* Circular queue implementation in an array */
+/* Run queue implementation as a doubly linked list through struct proc */
 #include "types.h"
 #include "defs.h"
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
+#include "spinlock.h"
 #include "proc.h"
 
-void push(Queue* queue, struct proc* proc) {
-    // cprintf("Pushing now ");
-    if ((queue->front == 0 && queue->rear == NPROC - 1) ||
-        (queue->front == queue->rear + 1)) {
-            // cprintf("Queue %d has overflown\n", queue->queue_id);
-            return;
-    }
+// Insert proc into queue just before next, or at the rear if next is 0.
+static void link(Queue* queue, struct proc* proc, struct proc* next) {
+    if (proc->queue)
+        panic("push: already queued");
 
-    if (queue->front == -1) {
-        // This is the case when the queue is empty
-        queue->front = 0;
-        queue->rear = 0;
+    proc->qnext = next;
+    if (next) {
+        proc->qprev = next->qprev;
+        next->qprev = proc;
     } else {
-        if (queue->rear == NPROC - 1) // Last element to be isnerted
-            queue->rear = 0;
-        else 
-            queue->rear = queue->rear + 1;
+        proc->qprev = queue->tail;
+        queue->tail = proc;
     }
-    queue->arr[queue->rear] = proc;
+    if (proc->qprev)
+        proc->qprev->qnext = proc;
+    else
+        queue->head = proc;
 
-    // cprintf(" - %d \n", queue->arr[queue->rear]->pid);
-    return;
+    proc->queue = queue;
+    queue->size++;
+}
+
+void push(Queue* queue, struct proc* proc) {
+    link(queue, proc, 0);
+}
+
+// Insert proc ahead of the first process that before() does not
+// put it ahead of, so processes that compare equal stay in FIFO order.
+void push_sorted(Queue* queue, struct proc* proc,
+                 int (*before)(struct proc*, struct proc*)) {
+    struct proc* p;
+
+    for (p = queue->head; p != 0; p = p->qnext)
+        if (before(proc, p))
+            break;
+    link(queue, proc, p);
+}
+
+// Take proc off whichever queue it is on.
+void qremove(struct proc* proc) {
+    Queue* queue = proc->queue;
+
+    if (queue == 0)
+        return;
+
+    if (proc->qprev)
+        proc->qprev->qnext = proc->qnext;
+    else
+        queue->head = proc->qnext;
+    if (proc->qnext)
+        proc->qnext->qprev = proc->qprev;
+    else
+        queue->tail = proc->qprev;
+
+    proc->qnext = proc->qprev = 0;
+    proc->queue = 0;
+    queue->size--;
 }
 
 struct proc* pop(Queue* queue) {
-    if (queue->front == -1) {
+    struct proc* proc = queue->head;
+
+    if (proc == 0) {
         // cprintf("Queue %d has underflown\n", queue->queue_id);
         return 0;
     }
-
-    int ret_ind = queue->front;
-
-    if (queue->front == queue->rear) {
-        // There is only one element in queue
-        queue->front = -1;
-        queue->rear = -1;
-    } else {
-        if (queue->front == NPROC - 1)
-            queue->front = 0;
-        else
-            queue->front = queue->front + 1;
-    }
-
-    return queue->arr[ret_ind];
+    qremove(proc);
+    return proc;
 }
 
 void display(Queue* queue) {
-    int front_pos = queue->front;
-    int rear_pos = queue->rear;
+    struct proc* p;
 
-    if (front_pos == -1) {
+    if (queue->head == 0) {
         cprintf("Queue is empty - Unable to display\n");
         return;
     }
 
     cprintf("Queue %d: \n", queue->queue_id);
-    if (front_pos <= rear_pos)
-        while(front_pos <= rear_pos) {
-            cprintf("%d ", queue->arr[front_pos]->pid);
-            front_pos++;
-        }
-    else {
-        while (front_pos <= MLFQSIZE - 1) {
-            cprintf("%d ", queue->arr[front_pos]->pid);
-            front_pos++;
-        }
-        front_pos = 0;
-        while (front_pos <= rear_pos) {
-            cprintf("%d ", queue->arr[front_pos]->pid);
-            front_pos++;
-        }
-    }
+    for (p = queue->head; p != 0; p = p->qnext)
+        cprintf("%d ", p->pid);
     cprintf("\n");
     return;
 }
 
 int get_size(Queue* queue) {
-    int front_pos = queue->front;
-    int rear_pos = queue->rear;
-
-    int size = 0;
-
-    if (front_pos == -1) 
-        return 0;
-
-    if (front_pos <= rear_pos)
-        while(front_pos <= rear_pos) {
-            size++;
-            front_pos++;
-        }
-    else {
-        while (front_pos <= MLFQSIZE - 1) {
-            size++;
-            front_pos++;
-        }
-        front_pos = 0;
-        while (front_pos <= rear_pos) {
-            size++;
-            front_pos++;
-        }
-    }
-    return size;
+    return queue->size;
 }
-
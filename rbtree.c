@@ -0,0 +1,247 @@
+// Red-black trees of processes.
+//
+// A run queue that must find its smallest process quickly
+// keeps its processes in a struct rbtree, threaded through
+// the rb* fields of struct proc and ordered by the tree's
+// before() function. Insertion and removal take O(log n)
+// and the leftmost process is cached in first. Processes
+// that compare equal keep the order they were inserted in.
+// Callers provide the locking.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+
+// Replace u in its parent's child pointer with v.
+static void
+replace(struct rbtree *t, struct proc *u, struct proc *v)
+{
+  if(u->rbparent == 0)
+    t->root = v;
+  else if(u == u->rbparent->rbleft)
+    u->rbparent->rbleft = v;
+  else
+    u->rbparent->rbright = v;
+  if(v)
+    v->rbparent = u->rbparent;
+}
+
+static void
+rotateleft(struct rbtree *t, struct proc *x)
+{
+  struct proc *y = x->rbright;
+
+  x->rbright = y->rbleft;
+  if(y->rbleft)
+    y->rbleft->rbparent = x;
+  replace(t, x, y);
+  y->rbleft = x;
+  x->rbparent = y;
+}
+
+static void
+rotateright(struct rbtree *t, struct proc *x)
+{
+  struct proc *y = x->rbleft;
+
+  x->rbleft = y->rbright;
+  if(y->rbright)
+    y->rbright->rbparent = x;
+  replace(t, x, y);
+  y->rbright = x;
+  x->rbparent = y;
+}
+
+static int
+isred(struct proc *p)
+{
+  return p != 0 && p->rbred;
+}
+
+static struct proc*
+leftmost(struct proc *p)
+{
+  while(p->rbleft)
+    p = p->rbleft;
+  return p;
+}
+
+void
+rbinsert(struct rbtree *t, struct proc *p)
+{
+  struct proc **link, *parent, *g, *u;
+  int first;
+
+  if(p->rbtree)
+    panic("rbinsert");
+
+  link = &t->root;
+  parent = 0;
+  first = 1;
+  while(*link){
+    parent = *link;
+    if(t->before(p, parent))
+      link = &parent->rbleft;
+    else {
+      link = &parent->rbright;
+      first = 0;
+    }
+  }
+  p->rbparent = parent;
+  p->rbleft = p->rbright = 0;
+  p->rbred = 1;
+  p->rbtree = t;
+  *link = p;
+  if(first)
+    t->first = p;
+  t->size++;
+
+  // Restore the red-black properties: while p and its
+  // parent are both red, recolour or rotate upwards.
+  while(isred(parent = p->rbparent)){
+    g = parent->rbparent;
+    if(parent == g->rbleft){
+      u = g->rbright;
+      if(isred(u)){
+        parent->rbred = u->rbred = 0;
+        g->rbred = 1;
+        p = g;
+        continue;
+      }
+      if(p == parent->rbright){
+        rotateleft(t, parent);
+        p = parent;
+        parent = p->rbparent;
+      }
+      parent->rbred = 0;
+      g->rbred = 1;
+      rotateright(t, g);
+    } else {
+      u = g->rbleft;
+      if(isred(u)){
+        parent->rbred = u->rbred = 0;
+        g->rbred = 1;
+        p = g;
+        continue;
+      }
+      if(p == parent->rbleft){
+        rotateright(t, parent);
+        p = parent;
+        parent = p->rbparent;
+      }
+      parent->rbred = 0;
+      g->rbred = 1;
+      rotateleft(t, g);
+    }
+  }
+  t->root->rbred = 0;
+}
+
+// Take p out of whichever tree it is in.
+void
+rberase(struct proc *p)
+{
+  struct rbtree *t = p->rbtree;
+  struct proc *x, *xparent, *y, *w;
+  int red;
+
+  if(t == 0)
+    return;
+
+  if(t->first == p)
+    t->first = p->rbright ? leftmost(p->rbright) : p->rbparent;
+
+  // Unlink p, or if it has two children its successor y
+  // moved into its place. x takes the place of whichever
+  // node was unlinked, and red is that node's colour.
+  if(p->rbleft == 0 || p->rbright == 0){
+    x = p->rbleft ? p->rbleft : p->rbright;
+    xparent = p->rbparent;
+    red = p->rbred;
+    replace(t, p, x);
+  } else {
+    y = leftmost(p->rbright);
+    x = y->rbright;
+    red = y->rbred;
+    if(y->rbparent == p)
+      xparent = y;
+    else {
+      xparent = y->rbparent;
+      replace(t, y, x);
+      y->rbright = p->rbright;
+      y->rbright->rbparent = y;
+    }
+    replace(t, p, y);
+    y->rbleft = p->rbleft;
+    y->rbleft->rbparent = y;
+    y->rbred = p->rbred;
+  }
+  p->rbtree = 0;
+  p->rbleft = p->rbright = p->rbparent = 0;
+  t->size--;
+
+  if(red)
+    return;
+
+  // A black node was removed: x's side of xparent is one
+  // black short. Push the shortage up or fix it by rotation.
+  while(x != t->root && !isred(x)){
+    if(x == xparent->rbleft){
+      w = xparent->rbright;
+      if(isred(w)){
+        w->rbred = 0;
+        xparent->rbred = 1;
+        rotateleft(t, xparent);
+        w = xparent->rbright;
+      }
+      if(!isred(w->rbleft) && !isred(w->rbright)){
+        w->rbred = 1;
+        x = xparent;
+        xparent = x->rbparent;
+        continue;
+      }
+      if(!isred(w->rbright)){
+        w->rbleft->rbred = 0;
+        w->rbred = 1;
+        rotateright(t, w);
+        w = xparent->rbright;
+      }
+      w->rbred = xparent->rbred;
+      xparent->rbred = 0;
+      w->rbright->rbred = 0;
+      rotateleft(t, xparent);
+    } else {
+      w = xparent->rbleft;
+      if(isred(w)){
+        w->rbred = 0;
+        xparent->rbred = 1;
+        rotateright(t, xparent);
+        w = xparent->rbleft;
+      }
+      if(!isred(w->rbleft) && !isred(w->rbright)){
+        w->rbred = 1;
+        x = xparent;
+        xparent = x->rbparent;
+        continue;
+      }
+      if(!isred(w->rbleft)){
+        w->rbright->rbred = 0;
+        w->rbred = 1;
+        rotateleft(t, w);
+        w = xparent->rbleft;
+      }
+      w->rbred = xparent->rbred;
+      xparent->rbred = 0;
+      w->rbleft->rbred = 0;
+      rotateright(t, xparent);
+    }
+    x = t->root;
+  }
+  if(x)
+    x->rbred = 0;
+}
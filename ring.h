@@ -0,0 +1,47 @@
+// Submission and completion queues for ringenter().
+//
+// User code describes each operation in sq[sqtail % RINGSIZE] and
+// advances sqtail, then calls ringenter(), which carries out the
+// queued operations in order in one system call. For each one it
+// advances sqhead and posts a completion in cq[cqtail % RINGSIZE]
+// holding the submission's data and the result the corresponding
+// system call would have returned. It stops early if the completion
+// queue is full; user code consumes completions by advancing cqhead.
+// Both the kernel and user programs use this header file.
+
+#define RINGSIZE 32  // entries in each queue
+
+// Operations
+#define RING_NOP    0
+#define RING_READ   1  // read(fd, addr, len), or pread at off
+#define RING_WRITE  2  // write(fd, addr, len), or pwrite at off
+#define RING_OPEN   3  // open(addr, len)
+#define RING_CLOSE  4  // close(fd)
+
+// An fd of RING_LASTFD names the descriptor returned by the last
+// RING_OPEN of the same ringenter(), so that a file can be opened,
+// used and closed with a single system call.
+#define RING_LASTFD (-2)
+
+struct sqe {
+  int op;
+  int fd;
+  uint addr;  // buffer, or path name for RING_OPEN
+  int len;    // byte count, or mode for RING_OPEN
+  int off;    // file offset, or -1 to use and advance the fd's offset
+  uint data;  // passed through to the completion
+};
+
+struct cqe {
+  uint data;  // from the submission
+  int res;    // result of the operation
+};
+
+struct ring {
+  uint sqhead;  // next submission the kernel will take
+  uint sqtail;  // next free submission slot
+  uint cqhead;  // next completion user code will take
+  uint cqtail;  // next free completion slot
+  struct sqe sq[RINGSIZE];
+  struct cqe cq[RINGSIZE];
+};
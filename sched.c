@@ -0,0 +1,970 @@
+// Scheduling classes.
+//
+// Each policy keeps its RUNNABLE processes on its own run
+// queues (queue.c) and is reached only through its struct
+// sched_class, so the policies can be mixed in one kernel and
+// changed while it runs (see setsched in proc.c). Every CPU
+// has its own set of run queues, a struct rq, and runs only
+// the processes on them; schedwake() chooses the CPU a
+// process waits for. Each struct rq has its own lock, and the
+// functions here that take a struct rq, or a process on one,
+// are called with that lock held; no CPU ever holds two.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+#include "vdso.h"
+
+// Policy for processes started before any setsched(0, ...).
+// The Makefile passes -DSCHEDULER=SCHED_$(SCHEDULER).
+#ifndef SCHEDULER
+#define SCHEDULER SCHED_RR
+#endif
+int defpolicy = SCHEDULER;
+
+// Initial MLFQ aging threshold in ticks, see setagethres().
+#ifndef AGETHRES
+#define AGETHRES 2
+#endif
+
+//PAGEBREAK!
+// Round robin: a single FIFO queue, preempted on every tick.
+static void
+rr_enqueue(struct rq *rq, struct proc *p)
+{
+  push(&rq->rr, p);
+}
+
+static void
+queue_dequeue(struct rq *rq, struct proc *p)
+{
+  qremove(p);
+}
+
+static struct proc*
+rr_pick_next(struct rq *rq)
+{
+  return pop(&rq->rr);
+}
+
+static int
+rr_tick(struct rq *rq, struct proc *p)
+{
+  return 1;
+}
+
+static struct sched_class rr_class = {
+  SCHED_RR, "round-robin",
+  rr_enqueue, queue_dequeue, rr_pick_next, rr_tick, rr_enqueue
+};
+
+// First come first serve: oldest process first,
+// and the timer never takes the CPU away from it.
+static int
+fcfs_before(struct proc *p, struct proc *q)
+{
+  return p->ctime < q->ctime;
+}
+
+static void
+fcfs_enqueue(struct rq *rq, struct proc *p)
+{
+  push_sorted(&rq->fcfs, p, fcfs_before);
+}
+
+static struct proc*
+fcfs_pick_next(struct rq *rq)
+{
+  return pop(&rq->fcfs);
+}
+
+static int
+fcfs_tick(struct rq *rq, struct proc *p)
+{
+  return 0;
+}
+
+static struct sched_class fcfs_class = {
+  SCHED_FCFS, "FCFS",
+  fcfs_enqueue, queue_dequeue, fcfs_pick_next, fcfs_tick, fcfs_enqueue
+};
+
+// Priority based: lowest priority value first, round robin
+// among equals, preempted on every tick.
+static int
+pbs_before(struct proc *p, struct proc *q)
+{
+  return p->priority < q->priority;
+}
+
+static void
+pbs_enqueue(struct rq *rq, struct proc *p)
+{
+  push_sorted(&rq->pbs, p, pbs_before);
+}
+
+static struct proc*
+pbs_pick_next(struct rq *rq)
+{
+  return pop(&rq->pbs);
+}
+
+static int
+pbs_tick(struct rq *rq, struct proc *p)
+{
+  return 1;
+}
+
+static struct sched_class pbs_class = {
+  SCHED_PBS, "Priority based",
+  pbs_enqueue, queue_dequeue, pbs_pick_next, pbs_tick, pbs_enqueue
+};
+
+//PAGEBREAK!
+// Multi-level feedback queue: a process may run for
+// (1 << q) ticks in queue q before it is moved down a
+// queue, and moves up one when it has waited in a queue
+// for more than agethres ticks, or when it wakes from sleep.
+int agethres = AGETHRES;
+
+// Each queue is in the order its processes joined it, so only
+// the processes at its head can have waited long enough.
+static void
+mlfq_age(struct rq *rq)
+{
+  struct proc *p;
+
+  for (int i = 1; i < MLFQSIZE; i++) {
+    while ((p = rq->mlfq[i].head) != 0 && ticks - p->mlfq_stamp > agethres) {
+      qremove(p);
+      p->cur_queue--;
+      p->mlfq_stamp = ticks;
+      // cprintf("%d moved from %d to %d at %d\n", p->pid, p->cur_queue + 1, p->cur_queue, ticks);
+      push(&rq->mlfq[p->cur_queue], p);
+    }
+  }
+}
+
+static void
+mlfq_enqueue(struct rq *rq, struct proc *p)
+{
+  p->time_slices = 0;
+  p->mlfq_stamp = ticks;
+  push(&rq->mlfq[p->cur_queue], p);
+}
+
+static struct proc*
+mlfq_pick_next(struct rq *rq)
+{
+  struct proc *p;
+
+  for (int i = 0; i < MLFQSIZE; i++)
+    if ((p = pop(&rq->mlfq[i])) != 0)
+      return p;
+  return 0;
+}
+
+// A process coming back from I/O moves up a queue, as
+// Solaris's time-sharing class raises the priority of a
+// thread that returns from sleep, so interactive processes
+// stay ahead of those that use up their time slices.
+static void
+mlfq_wakeup(struct proc *p)
+{
+  if (p->cur_queue > 0)
+    p->cur_queue--;
+}
+
+// Preempt when the time slice for the queue is used up,
+// or when a process is waiting in a higher queue.
+static int
+mlfq_tick(struct rq *rq, struct proc *p)
+{
+  p->queue_ticks[p->cur_queue]++;
+  p->time_slices++;
+  if (VMLFQ(p->cur_queue, p->time_slices) == 1) {
+    p->punish = 1;
+    return 1;
+  }
+  for (int i = 0; i < p->cur_queue; i++)
+    if (get_size(&rq->mlfq[i]) != 0)
+      return 1;
+  return 0;
+}
+
+static void
+mlfq_yield(struct rq *rq, struct proc *p)
+{
+  if (p->punish) {
+    p->punish = 0;
+    p->time_slices = 0;
+    if (p->cur_queue != MLFQSIZE - 1) {
+      p->cur_queue++;
+      // cprintf("%d moved from %d to %d at %d\n", p->pid, p->cur_queue - 1, p->cur_queue, ticks);
+    }
+  }
+  p->mlfq_stamp = ticks;
+  push(&rq->mlfq[p->cur_queue], p);
+}
+
+static struct sched_class mlfq_class = {
+  SCHED_MLFQ, "Multi-level Feedback Queue",
+  mlfq_enqueue, queue_dequeue, mlfq_pick_next, mlfq_tick, mlfq_yield,
+  mlfq_wakeup
+};
+
+//PAGEBREAK!
+// Completely fair: each process's run time is scaled by
+// NICE0/weight into its vruntime, and the process with the
+// smallest vruntime runs next, taken from a red-black tree.
+// Weights come from priority as Linux's do from nice, with
+// the default priority of 60 as nice 0.
+#define NICE0       1024
+#define CFSLATENCY  40   // ms in which every runnable process should run
+#define CFSMINGRAN  10   // ms, the shortest slice
+
+static const int prio_to_weight[40] = {
+  /* -20 */ 88761, 71755, 56483, 46273, 36291,
+  /* -15 */ 29154, 23254, 18705, 14949, 11916,
+  /* -10 */  9548,  7620,  6100,  4904,  3906,
+  /*  -5 */  3121,  2501,  1991,  1586,  1277,
+  /*   0 */  1024,   820,   655,   526,   423,
+  /*   5 */   335,   272,   215,   172,   137,
+  /*  10 */   110,    87,    70,    56,    45,
+  /*  15 */    36,    29,    23,    18,    15,
+};
+
+static int
+cfs_before(struct proc *p, struct proc *q)
+{
+  return p->vruntime < q->vruntime;
+}
+
+uint
+prioweight(int priority)
+{
+  int nice = (priority - 60) / 2;
+
+  if (nice < -20)
+    nice = -20;
+  if (nice > 19)
+    nice = 19;
+  return prio_to_weight[nice + 20];
+}
+
+// p's weight, scaled by its groups' shares (see group.c).
+static uint
+cfs_weight(struct proc *p)
+{
+  return groupweight(p->group, prioweight(p->priority));
+}
+
+// Add the run time p has had since the last call to its vruntime.
+static void
+cfs_charge(struct proc *p)
+{
+  uint64 rtime = p->rtime;
+
+  if (p->state == RUNNING)
+    rtime += rdtsc() - p->stamp;
+  p->vruntime += div64((rtime - p->vcharged) * NICE0, cfs_weight(p));
+  p->vcharged = rtime;
+}
+
+static void
+cfs_yield(struct rq *rq, struct proc *p)
+{
+  cfs_charge(p);
+  rbinsert(&rq->cfs, p);
+  p->cfsweight = cfs_weight(p);
+  rq->cfsload += p->cfsweight;
+}
+
+// A process that has been asleep, or is new, starts no more
+// than half a latency period ahead of the others, so it runs
+// soon but cannot bank the time it spent away. One that comes
+// from another CPU keeps its lead over that CPU's queue.
+static void
+cfs_enqueue(struct rq *rq, struct proc *p)
+{
+  uint64 half = (uint64)tsckhz * CFSLATENCY / 2;
+
+  cfs_charge(p);
+  if (p->migrating)
+    p->vruntime += rq->min_vruntime;
+  if (rq->min_vruntime > half && p->vruntime < rq->min_vruntime - half)
+    p->vruntime = rq->min_vruntime - half;
+  rbinsert(&rq->cfs, p);
+  p->cfsweight = cfs_weight(p);
+  rq->cfsload += p->cfsweight;
+}
+
+static void
+cfs_dequeue(struct rq *rq, struct proc *p)
+{
+  if (p->rbtree == 0)
+    return;
+  rberase(p);
+  rq->cfsload -= p->cfsweight;
+}
+
+static struct proc*
+cfs_pick_next(struct rq *rq)
+{
+  struct proc *p = rq->cfs.first;
+
+  if (p == 0)
+    return 0;
+  cfs_dequeue(rq, p);
+  if (p->vruntime > rq->min_vruntime)
+    rq->min_vruntime = p->vruntime;
+  return p;
+}
+
+// The slice is p's share, by weight, of the latency period,
+// so it shrinks as more processes become runnable.
+static int
+cfs_tick(struct rq *rq, struct proc *p)
+{
+  uint w = cfs_weight(p);
+  uint64 slice;
+
+  cfs_charge(p);
+  if (rq->cfs.first == 0)
+    return 0;
+  slice = div64((uint64)tsckhz * CFSLATENCY * w, rq->cfsload + w);
+  if (slice < (uint64)tsckhz * CFSMINGRAN)
+    slice = (uint64)tsckhz * CFSMINGRAN;
+  return rdtsc() - p->stamp >= slice;
+}
+
+static struct sched_class cfs_class = {
+  SCHED_CFS, "Completely Fair",
+  cfs_enqueue, cfs_dequeue, cfs_pick_next, cfs_tick, cfs_yield
+};
+
+//PAGEBREAK!
+// Stride: each process's pass advances by STRIDE1/tickets
+// for every ms it runs, and the process with the lowest pass
+// runs next, so over time run time follows the ticket ratio.
+// A process that was not runnable rejoins at the current
+// global pass rather than catching up on its lost share.
+#define STRIDE1  (1 << 16)
+
+static int
+stride_before(struct proc *p, struct proc *q)
+{
+  return p->pass < q->pass;
+}
+
+// If the TSC was not calibrated, count its cycles as if it ran at
+// 1 GHz: any rate keeps the ratio between processes' passes.
+static void
+stride_charge(struct proc *p)
+{
+  uint khz = tsckhz ? tsckhz : 1000000;
+
+  p->pass += div64((p->rtime - p->vcharged) * (STRIDE1 / p->tickets), khz);
+  p->vcharged = p->rtime;
+}
+
+static void
+stride_yield(struct rq *rq, struct proc *p)
+{
+  stride_charge(p);
+  rbinsert(&rq->stride, p);
+}
+
+static void
+stride_enqueue(struct rq *rq, struct proc *p)
+{
+  stride_charge(p);
+  if (p->migrating)
+    p->pass += rq->global_pass;
+  if (p->pass < rq->global_pass)
+    p->pass = rq->global_pass;
+  rbinsert(&rq->stride, p);
+}
+
+static void
+tree_dequeue(struct rq *rq, struct proc *p)
+{
+  rberase(p);
+}
+
+static struct proc*
+stride_pick_next(struct rq *rq)
+{
+  struct proc *p = rq->stride.first;
+
+  if (p == 0)
+    return 0;
+  rberase(p);
+  if (p->pass > rq->global_pass)
+    rq->global_pass = p->pass;
+  return p;
+}
+
+static int
+stride_tick(struct rq *rq, struct proc *p)
+{
+  return 1;
+}
+
+static struct sched_class stride_class = {
+  SCHED_STRIDE, "Stride",
+  stride_enqueue, tree_dequeue, stride_pick_next, stride_tick, stride_yield
+};
+
+// Lottery: every tick, draw one of the runnable processes'
+// tickets at random and run its holder.
+static uint seed = 1;
+
+static void
+lottery_enqueue(struct rq *rq, struct proc *p)
+{
+  push(&rq->lottery, p);
+  rq->lotterytickets += p->tickets;
+}
+
+static void
+lottery_dequeue(struct rq *rq, struct proc *p)
+{
+  if (p->queue == 0)
+    return;
+  qremove(p);
+  rq->lotterytickets -= p->tickets;
+}
+
+static struct proc*
+lottery_pick_next(struct rq *rq)
+{
+  struct proc *p;
+  uint winner;
+
+  if (rq->lotterytickets == 0)
+    return 0;
+  seed = seed * 1103515245 + 12345;
+  winner = (seed >> 8) % rq->lotterytickets;
+  for (p = rq->lottery.head; winner >= p->tickets; p = p->qnext)
+    winner -= p->tickets;
+  lottery_dequeue(rq, p);
+  return p;
+}
+
+static struct sched_class lottery_class = {
+  SCHED_LOTTERY, "Lottery",
+  lottery_enqueue, lottery_dequeue, lottery_pick_next, stride_tick, lottery_enqueue
+};
+
+//PAGEBREAK!
+// Earliest deadline first, with each process's CPU time held
+// to its reservation by a constant bandwidth server: the time
+// it runs comes out of dl_budget, and when that runs out it
+// is throttled until its deadline, when the next period's
+// budget is given and the deadline moves a period on.
+// setdeadline() in proc.c makes a process a deadline process.
+static int
+edf_before(struct proc *p, struct proc *q)
+{
+  return p->dl_abs < q->dl_abs;
+}
+
+// Take what p has run since last charged out of its budget.
+static void
+edf_charge(struct proc *p)
+{
+  uint64 rtime = p->rtime, used;
+
+  if (p->state == RUNNING)
+    rtime += rdtsc() - p->stamp;
+  used = rtime - p->vcharged;
+  p->vcharged = rtime;
+  p->dl_budget = p->dl_budget > used ? p->dl_budget - used : 0;
+}
+
+// Give throttled processes whose deadline has come
+// their next period's budget and make them runnable.
+static void
+edf_replenish(struct rq *rq)
+{
+  struct proc *p, *next;
+  uint64 now = rdtsc();
+
+  for (p = rq->throttled.head; p != 0; p = next) {
+    next = p->qnext;
+    if (now < p->dl_abs)
+      continue;
+    qremove(p);
+    p->dl_abs += p->dl_period;
+    if (p->dl_abs < now)
+      p->dl_abs = now + p->dl_deadline;
+    p->dl_budget = p->dl_runtime;
+    rbinsert(&rq->edf, p);
+  }
+}
+
+// A process that is woken keeps its deadline and budget only if
+// running the budget out before the deadline would not use more
+// than its reserved bandwidth; otherwise it starts a new period.
+static void
+edf_enqueue(struct rq *rq, struct proc *p)
+{
+  uint64 now = rdtsc();
+
+  edf_charge(p);
+  // Compare in units of 1024 cycles: the products of whole cycle
+  // counts up to EDFMAXPERIOD overflow once the TSC passes 4 GHz.
+  if (p->dl_abs <= now ||
+      (p->dl_budget >> 10) * (p->dl_period >> 10) >
+      ((p->dl_abs - now) >> 10) * (p->dl_runtime >> 10)) {
+    p->dl_abs = now + p->dl_deadline;
+    p->dl_budget = p->dl_runtime;
+  }
+  if (p->dl_budget == 0)
+    push(&rq->throttled, p);
+  else
+    rbinsert(&rq->edf, p);
+}
+
+static void
+edf_yield(struct rq *rq, struct proc *p)
+{
+  edf_charge(p);
+  if (p->dl_budget == 0)
+    push(&rq->throttled, p);
+  else
+    rbinsert(&rq->edf, p);
+}
+
+static void
+edf_dequeue(struct rq *rq, struct proc *p)
+{
+  rberase(p);
+  qremove(p);
+}
+
+static struct proc*
+edf_pick_next(struct rq *rq)
+{
+  struct proc *p;
+
+  edf_replenish(rq);
+  if ((p = rq->edf.first) != 0)
+    rberase(p);
+  return p;
+}
+
+// Count a miss when p is still running at its deadline, and
+// move the deadline on so that it is counted once. Preempt p
+// when its budget is used up or an earlier deadline is waiting.
+static int
+edf_tick(struct rq *rq, struct proc *p)
+{
+  uint64 now = rdtsc();
+
+  edf_charge(p);
+  if (now > p->dl_abs) {
+    p->dl_misses++;
+    p->dl_abs = now + p->dl_deadline;
+    p->dl_budget = p->dl_runtime;
+  }
+  if (p->dl_budget == 0)
+    return 1;
+  return rq->edf.first != 0 && rq->edf.first->dl_abs < p->dl_abs;
+}
+
+static struct sched_class edf_class = {
+  SCHED_EDF, "Earliest Deadline First",
+  edf_enqueue, edf_dequeue, edf_pick_next, edf_tick, edf_yield
+};
+
+// Indexed by policy.
+struct sched_class *sched_classes[NSCHED] = {
+  [SCHED_RR]    &rr_class,
+  [SCHED_FCFS]  &fcfs_class,
+  [SCHED_PBS]   &pbs_class,
+  [SCHED_MLFQ]  &mlfq_class,
+  [SCHED_CFS]   &cfs_class,
+  [SCHED_STRIDE]  &stride_class,
+  [SCHED_LOTTERY] &lottery_class,
+  [SCHED_EDF]   &edf_class,
+};
+
+// The order in which the scheduler asks the classes for a
+// process, so a runnable process of an earlier class always
+// runs before one of a later class. Deadline processes first.
+struct sched_class *sched_order[NSCHED] = {
+  &edf_class,
+  &rr_class,
+  &fcfs_class,
+  &pbs_class,
+  &mlfq_class,
+  &cfs_class,
+  &stride_class,
+  &lottery_class,
+};
+
+//PAGEBREAK!
+// How busy CPU c is: the processes waiting on its
+// run queues and the one it is running.
+static int
+cpuload(struct cpu *c)
+{
+  return c->rq.nrunnable + (c->proc != 0);
+}
+
+// The number of the CPU whose run queues rq are.
+static int
+rqcpu(struct rq *rq)
+{
+  return ((char*)rq - (char*)&cpus[0].rq) / sizeof(struct cpu);
+}
+
+// Choose the CPU whose run queues RUNNABLE p should wait on.
+// A process that wakes up goes back to the CPU it last ran on,
+// whose caches may still hold its data, unless that CPU is
+// busier by two or more processes than the least busy CPU p
+// may run on. The loads are read without their locks, as a
+// hint.
+static struct rq*
+selectrq(struct proc *p)
+{
+  struct cpu *c, *best, *last;
+
+  last = 0;
+  if (p->cpu >= 0 && (p->affinity & (1 << p->cpu)))
+    last = &cpus[p->cpu];
+
+  best = 0;
+  for (c = cpus; c < cpus+ncpu; c++) {
+    if ((p->affinity & (1 << (c-cpus))) == 0)
+      continue;
+    if (best == 0 || cpuload(c) < cpuload(best))
+      best = c;
+  }
+  if (best == 0 || (last && cpuload(last) < cpuload(best) + 2))
+    return last ? &last->rq : &cpus[0].rq;
+  return &best->rq;
+}
+
+// Put RUNNABLE p on rq's queues.
+static void
+rqenqueue(struct rq *rq, struct proc *p, int preempted)
+{
+  if (preempted)
+    p->sched->yield(rq, p);
+  else
+    p->sched->enqueue(rq, p);
+  p->rq = rq;
+  p->migrating = 0;
+  rq->nrunnable++;
+  p->rqprev = 0;
+  p->rqnext = rq->tasks;
+  if (rq->tasks)
+    rq->tasks->rqprev = p;
+  rq->tasks = p;
+}
+
+static void
+rqunlink(struct rq *rq, struct proc *p)
+{
+  if (p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    rq->tasks = p->rqnext;
+  if (p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  p->rqnext = p->rqprev = 0;
+  rq->nrunnable--;
+}
+
+// Mark p, which is on none of rq's queues, as on its way to
+// another CPU's, keeping its CFS virtual run time and stride
+// pass relative to rq's so that rqenqueue() can carry its
+// place in the queues over to the new CPU's.
+static void
+rqleave(struct rq *rq, struct proc *p)
+{
+  p->vruntime = p->vruntime > rq->min_vruntime ? p->vruntime - rq->min_vruntime : 0;
+  p->pass = p->pass > rq->global_pass ? p->pass - rq->global_pass : 0;
+  p->migrating = 1;
+}
+
+// Put p, which was running on this CPU and has been preempted
+// or has yielded, back on its run queues, whose lock the caller
+// holds. It must stay on them until it has been switched out,
+// so the scheduler moves it if it may no longer run here.
+void
+schedenqueue(struct proc *p)
+{
+  rqenqueue(p->rq, p, 1);
+}
+
+// Put p, which has become RUNNABLE after sleeping (from is
+// SLEEPING) or being made, or which scheddetach() took off its
+// run queues, on a CPU's run queues. The caller holds p->lock,
+// or took p off its queues itself, and no run queue lock.
+void
+schedwake(struct proc *p, int from)
+{
+  struct rq *rq, *old;
+
+  if (from == SLEEPING && p->sched->wakeup)
+    p->sched->wakeup(p);
+  rq = selectrq(p);
+  old = p->rq;
+  if (old && old != rq && !p->migrating) {
+    acquire(&old->lock);
+    rqleave(old, p);
+    release(&old->lock);
+  }
+  acquire(&rq->lock);
+  rqenqueue(rq, p, 0);
+  release(&rq->lock);
+}
+
+// Take RUNNABLE p off its run queues.
+void
+scheddequeue(struct proc *p)
+{
+  if (p->queue == &p->rq->grouphold)
+    qremove(p);
+  else
+    p->sched->dequeue(p->rq, p);
+  rqunlink(p->rq, p);
+}
+
+// Take RUNNABLE p off its run queues to move it to another CPU
+// with schedwake(). Until then it is on no run queues.
+void
+scheddetach(struct proc *p)
+{
+  scheddequeue(p);
+  rqleave(p->rq, p);
+}
+
+// Lock the run queues of p, if it is RUNNABLE or RUNNING, so
+// that its scheduling parameters can be changed, taking it off
+// them if it is RUNNABLE. Returns them, or 0 if p is on none.
+// The caller holds p->lock, which keeps p from going to sleep,
+// exiting or waking up meanwhile.
+struct rq*
+schedlock(struct proc *p)
+{
+  struct rq *rq;
+
+  if (p->state != RUNNABLE && p->state != RUNNING)
+    return 0;
+  for (;;) {
+    // It may be on its way to another CPU.
+    while (*(volatile int*)&p->migrating)
+      ;
+    rq = p->rq;
+    acquire(&rq->lock);
+    if (rq == p->rq && !p->migrating)
+      break;
+    release(&rq->lock);
+  }
+  if (p->state == RUNNABLE)
+    scheddequeue(p);
+  return rq;
+}
+
+// Undo schedlock(): put p back on rq's queues, or if its
+// affinity no longer allows rq's CPU, on another CPU's. A
+// RUNNING process moves at its next tick (see schedpreempt).
+void
+schedunlock(struct proc *p, struct rq *rq)
+{
+  if (rq == 0)
+    return;
+  if (p->state == RUNNABLE && (p->affinity & (1 << rqcpu(rq))) == 0) {
+    rqleave(rq, p);
+    release(&rq->lock);
+    schedwake(p, RUNNABLE);
+    return;
+  }
+  if (p->state == RUNNABLE)
+    rqenqueue(rq, p, 0);
+  release(&rq->lock);
+}
+
+// Dequeue the next process for CPU c to run, or return 0,
+// asking each class in turn, and note where it runs. A
+// process whose group is out of quota is held back in
+// grouphold until the group's period ends.
+struct proc*
+schedpick(struct cpu *c)
+{
+  struct proc *p;
+
+  for (int i = 0; i < NSCHED; i++) {
+    while ((p = sched_order[i]->pick_next(&c->rq)) != 0) {
+      if (groupthrottled(p->group)) {
+        push(&c->rq.grouphold, p);
+        continue;
+      }
+      rqunlink(&c->rq, p);
+      if (p->cpu >= 0 && p->cpu != c-cpus)
+        p->migrations++;
+      p->cpu = c-cpus;
+      return p;
+    }
+  }
+  return 0;
+}
+
+//PAGEBREAK!
+// Load balancing. Every BALANCETICKS ticks each CPU compares
+// its load average with the other CPUs' and, if the busiest is
+// more than BALANCEPCT percent as loaded, pulls processes from
+// it; a CPU with nothing to run does so at once, going by the
+// current loads. Either way it pulls only until the two CPUs'
+// current loads differ by at most one, so a process is never
+// moved to a CPU that would then be the busier of the two.
+// The busiest CPU is chosen from loads read without locks; the
+// processes to move are taken off its queues holding its lock
+// and put on this CPU's holding this one's, so the caller must
+// hold neither.
+#define LOADSHIFT     10   // load is fixed point, 1 << LOADSHIFT a process
+#define LOADDECAY     3    // each tick moves it 1/8 of the way to the current load
+#define BALANCETICKS  4
+#define BALANCEPCT    125
+#define MIGRATECOST   2    // a process runnable for less than 1/2 ms is cache hot
+
+void
+schedbalance(struct cpu *c, int idle)
+{
+  struct cpu *d, *busiest;
+  struct proc *p, *next, *moved;
+  uint64 now;
+  int n;
+
+  busiest = 0;
+  for (d = cpus; d < cpus+ncpu; d++) {
+    if (d == c || d->rq.nrunnable == 0)
+      continue;
+    if (busiest == 0 ||
+        (idle ? cpuload(d) > cpuload(busiest) : d->rq.load > busiest->rq.load))
+      busiest = d;
+  }
+  if (busiest == 0)
+    return;
+  if (!idle && (uint64)busiest->rq.load * 100 <= (uint64)c->rq.load * BALANCEPCT)
+    return;
+
+  // Leave processes that have only just stopped running where
+  // their cache is, unless this CPU would otherwise be idle.
+  moved = 0;
+  acquire(&busiest->rq.lock);
+  now = rdtsc();
+  n = (cpuload(busiest) - cpuload(c)) / 2;
+  for (p = busiest->rq.tasks; p != 0 && n > 0; p = next) {
+    next = p->rqnext;
+    if ((p->affinity & (1 << (c-cpus))) == 0 ||
+        p->queue == &busiest->rq.grouphold)
+      continue;
+    if (!idle && now - p->stamp < tsckhz / MIGRATECOST)
+      continue;
+    scheddetach(p);
+    p->rqnext = moved;
+    moved = p;
+    vdso->cpu[busiest-cpus].nmigout++;
+    n--;
+  }
+  release(&busiest->rq.lock);
+  if (moved == 0)
+    return;
+
+  acquire(&c->rq.lock);
+  for (p = moved; p != 0; p = next) {
+    next = p->rqnext;
+    rqenqueue(&c->rq, p, 0);
+    vdso->cpu[c-cpus].nmigin++;
+  }
+  release(&c->rq.lock);
+}
+
+// Called on every timer tick on CPU c, holding its run queue
+// lock: update c's load average, move MLFQ processes that have
+// waited long enough up a queue, and put back processes whose
+// group has quota again. Returns 1 every BALANCETICKS ticks,
+// when the caller should balance load once it has released
+// the lock.
+int
+schedclock(struct cpu *c)
+{
+  struct rq *rq = &c->rq;
+  uint cur = cpuload(c) << LOADSHIFT;
+  struct proc *p, *next;
+
+  for (p = rq->grouphold.head; p != 0; p = next) {
+    next = p->qnext;
+    if (!groupthrottled(p->group)) {
+      qremove(p);
+      p->sched->enqueue(rq, p);
+    }
+  }
+
+  rq->load = rq->load - (rq->load >> LOADDECAY) + (cur >> LOADDECAY);
+  vdso->cpu[c-cpus].load = (rq->load * 100) >> LOADSHIFT;
+  mlfq_age(rq);
+  if (++rq->balticks >= BALANCETICKS) {
+    rq->balticks = 0;
+    return 1;
+  }
+  return 0;
+}
+
+// Called on a timer tick while p runs, holding its CPU's run
+// queue lock: whether p should give
+// up the CPU, because its class says so, because it is not a
+// deadline process and a deadline process is waiting, because
+// its affinity no longer allows this CPU, or because its group
+// has used up its quota.
+int
+schedpreempt(struct proc *p)
+{
+  struct rq *rq = &mycpu()->rq;
+  int preempt;
+
+  preempt = p->sched->tick(rq, p);
+  if (p->sched != &edf_class) {
+    edf_replenish(rq);
+    if (rq->edf.first != 0)
+      preempt = 1;
+  }
+  if ((p->affinity & (1 << p->cpu)) == 0)
+    preempt = 1;
+  groupcharge(p);
+  if (groupthrottled(p->group))
+    preempt = 1;
+  return preempt;
+}
+
+void
+schedinit(void)
+{
+  struct rq *rq;
+
+  for (struct cpu *c = cpus; c < cpus+NCPU; c++) {
+    rq = &c->rq;
+    initlock(&rq->lock, "rq");
+    initlock(&c->timerlock, "timers");
+    for (int i = 0; i < MLFQSIZE; i++)
+      rq->mlfq[i].queue_id = i;
+    rq->cfs.before = cfs_before;
+    rq->stride.before = stride_before;
+    rq->edf.before = edf_before;
+  }
+  if (defpolicy < 0 || defpolicy >= NSCHED || defpolicy == SCHED_EDF)
+    defpolicy = SCHED_RR;
+  groupinit();
+}
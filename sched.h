@@ -0,0 +1,20 @@
+// Scheduling policies, for setsched().
+// Both the kernel and user programs use this header file.
+
+#define SCHED_RR    0  // round robin, one tick at a time
+#define SCHED_FCFS  1  // first come first serve, never preempted
+#define SCHED_PBS   2  // lowest set_priority() value first
+#define SCHED_MLFQ  3  // multi-level feedback queue
+#define SCHED_CFS   4  // completely fair, weighted by priority
+#define SCHED_STRIDE  5  // proportional share by tickets, deterministic
+#define SCHED_LOTTERY 6  // proportional share by tickets, randomized
+#define SCHED_EDF   7  // earliest deadline first, see setdeadline()
+#define NSCHED      8
+
+// Tickets for the proportional share policies, see settickets()
+#define DEFTICKETS  100   // a new process's tickets
+#define MAXTICKETS  1000
+
+// CPU groups, see mkgroup() and groupctl()
+#define DEFSHARES   1024  // a group's weight among its siblings
+#define MAXSHARES   65536
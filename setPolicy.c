@@ -0,0 +1,35 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+static char *names[] = {
+    [SCHED_RR]    "rr",
+    [SCHED_FCFS]  "fcfs",
+    [SCHED_PBS]   "pbs",
+    [SCHED_MLFQ]  "mlfq",
+    [SCHED_CFS]   "cfs",
+    [SCHED_STRIDE]  "stride",
+    [SCHED_LOTTERY] "lottery",
+    [SCHED_EDF]   "edf"
+};
+
+int
+main(int argc, char **argv)
+{
+    int policy;
+
+    if(argc != 3 || strcmp(argv[0], "setPolicy")) {
+        printf(2, "usage: setPolicy pid rr|fcfs|pbs|mlfq|cfs|stride|lottery (pid 0 for all processes; edf is set with setdeadline)\n");
+        exit();
+    }
+
+    for(policy = 0; policy < NSCHED; policy++)
+        if(names[policy] && strcmp(argv[2], names[policy]) == 0)
+            break;
+
+    if(policy == NSCHED || setsched(atoi(argv[1]), policy) < 0)
+        printf(2, "setPolicy: failed\n");
+
+    exit();
+}
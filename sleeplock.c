@@ -6,8 +6,8 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
 #include "sleeplock.h"
 
 void
@@ -17,26 +17,45 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->holder = 0;
+  lk->waitpri = NOPRIORITY;
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  struct proc *p = myproc();
+
   acquire(&lk->lk);
   while (lk->locked) {
+    lockwait(lk);
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
-  lk->pid = myproc()->pid;
+  lk->pid = p->pid;
+  lk->holder = p;
+  lk->next = p->locks;
+  p->locks = lk;
   release(&lk->lk);
 }
 
 void
 releasesleep(struct sleeplock *lk)
 {
+  struct sleeplock **l;
+
   acquire(&lk->lk);
+  for (l = &lk->holder->locks; *l != lk; l = &(*l)->next)
+    ;
+  *l = lk->next;
+  lk->next = 0;
+  if (lk->waitpri != NOPRIORITY) {
+    lk->waitpri = NOPRIORITY;
+    lockrelease(lk->holder);
+  }
   lk->locked = 0;
   lk->pid = 0;
+  lk->holder = 0;
   wakeup(lk);
   release(&lk->lk);
 }
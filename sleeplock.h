@@ -3,6 +3,11 @@ struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
   
+  // For priority inheritance, see lockwait() in proc.c:
+  struct proc *holder;      // Process holding lock
+  int waitpri;              // Best priority of a waiter, or NOPRIORITY
+  struct sleeplock *next;   // Next lock its holder holds
+
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
@@ -12,11 +12,14 @@
 #include "user.h"
 #include "fs.h"
 #include "fcntl.h"
+#include "ring.h"
+
+struct ring r;
 
 int
 main(int argc, char *argv[])
 {
-  int fd, i;
+  int i;
   char path[] = "stressfs0";
   char data[512];
 
@@ -29,19 +32,24 @@ main(int argc, char *argv[])
 
   printf(1, "write %d\n", i);
 
+  // Each pass opens the file, does 20 block-sized transfers
+  // and closes it again, all in one ringenter().
   path[8] += i;
-  fd = open(path, O_CREATE | O_RDWR);
+  ringpush(&r, RING_OPEN, 0, path, O_CREATE | O_RDWR, 0);
   for(i = 0; i < 20; i++)
-//    printf(fd, "%d\n", i);
-    write(fd, data, sizeof(data));
-  close(fd);
+    ringpush(&r, RING_WRITE, RING_LASTFD, data, sizeof(data), -1);
+  ringpush(&r, RING_CLOSE, RING_LASTFD, 0, 0, 0);
+  ringenter(&r);
+  r.cqhead = r.cqtail;
 
   printf(1, "read\n");
 
-  fd = open(path, O_RDONLY);
+  ringpush(&r, RING_OPEN, 0, path, O_RDONLY, 0);
   for (i = 0; i < 20; i++)
-    read(fd, data, sizeof(data));
-  close(fd);
+    ringpush(&r, RING_READ, RING_LASTFD, data, sizeof(data), -1);
+  ringpush(&r, RING_CLOSE, RING_LASTFD, 0, 0, 0);
+  ringenter(&r);
+  r.cqhead = r.cqtail;
 
   wait();
 
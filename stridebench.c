@@ -0,0 +1,85 @@
+// Proportional share benchmark.
+// For each CPU, three children hold 100, 200 and 300 tickets
+// and spin for the same DURATION ticks under the stride policy,
+// or the policy given. Each three are pinned to their own CPU,
+// as stride and lottery share out each CPU's time separately and
+// the balancer does not look at tickets. The CPU time each
+// ticket class gets should follow the 1:2:3 ratio to within
+// TOLERANCE percent.
+// Run it with CPUS=1 to 4.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "memlayout.h"
+#include "vdso.h"
+#include "clock.h"
+#include "sched.h"
+
+#define DURATION  500  // ticks
+#define TOLERANCE 10   // percent
+
+int
+main(int argc, char *argv[])
+{
+  int pids[3*NCPU], policy, ncpu, n, i, k, pid, end, fail;
+  uint run[3], total, err;
+  struct ptimes pt;
+
+  policy = argc > 1 ? atoi(argv[1]) : SCHED_STRIDE;
+  if(setsched(getpid(), policy) < 0){
+    printf(2, "usage: stridebench [policy 0-%d]\n", NSCHED-1);
+    exit();
+  }
+
+  ncpu = ((struct vdso*)VDSO)->ncpu;
+  n = 3*ncpu;
+  end = uptime() + DURATION;
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0){
+      printf(2, "stridebench: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      if(setaffinity(0, 1 << (i/3)) < 0){
+        printf(2, "stridebench: setaffinity failed\n");
+        exit();
+      }
+      settickets(getpid(), 100*(i%3 + 1));
+      while(uptime() < end)
+        ;
+      exit();
+    }
+    pids[i] = pid;
+  }
+
+  run[0] = run[1] = run[2] = 0;
+  for(k = 0; k < n; k++){
+    if((pid = waitx2(&pt)) < 0)
+      break;
+    for(i = 0; i < n; i++)
+      if(pids[i] == pid)
+        run[i%3] += pt.rtime.sec*1000 + pt.rtime.nsec/1000000;
+  }
+
+  total = run[0] + run[1] + run[2];
+  if(total == 0){
+    printf(2, "stridebench: no run time\n");
+    exit();
+  }
+  fail = 0;
+  printf(1, "%d cpus, %d children\n", ncpu, n);
+  for(k = 0; k < 3; k++){
+    // Expected share is (k+1)/6 of the total.
+    err = run[k]*6 > total*(k+1) ? run[k]*6 - total*(k+1) : total*(k+1) - run[k]*6;
+    err = err * 100 / (total*(k+1));
+    printf(1, "tickets %d: %d ms, %d%% of the total, want %d%%, off by %d%%\n",
+           100*(k+1), run[k], run[k]*100/total, (k+1)*100/6, err);
+    if(err > TOLERANCE)
+      fail = 1;
+  }
+  printf(1, fail ? "stridebench: FAIL\n" : "stridebench: OK\n");
+  exit();
+}
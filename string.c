@@ -1,14 +1,26 @@
 #include "types.h"
 #include "x86.h"
 
+// Fill a byte at a time up to a word boundary,
+// then a word at a time, then the leftover bytes.
 void*
 memset(void *dst, int c, uint n)
 {
-  if ((int)dst%4 == 0 && n%4 == 0){
-    c &= 0xFF;
-    stosl(dst, (c<<24)|(c<<16)|(c<<8)|c, n/4);
-  } else
-    stosb(dst, c, n);
+  char *d;
+  uint head;
+
+  d = dst;
+  c &= 0xFF;
+  if(n >= 8){
+    head = -(uint)d & 3;
+    stosb(d, c, head);
+    d += head;
+    n -= head;
+    stosl(d, (c<<24)|(c<<16)|(c<<8)|c, n/4);
+    d += n & ~3;
+    n &= 3;
+  }
+  stosb(d, c, n);
   return dst;
 }
 
@@ -28,23 +40,37 @@ memcmp(const void *v1, const void *v2, uint n)
   return 0;
 }
 
+// Copy with rep movs, a word at a time where possible.
+// Going forwards, bytes are copied first to word-align dst.
+// Overlapping moves to a higher address go backwards.
 void*
 memmove(void *dst, const void *src, uint n)
 {
   const char *s;
   char *d;
+  uint head;
 
   s = src;
   d = dst;
   if(s < d && s + n > d){
-    s += n;
-    d += n;
-    while(n-- > 0)
-      *--d = *--s;
-  } else
-    while(n-- > 0)
-      *d++ = *s++;
-
+    if((((uint)s | (uint)d | n) & 3) == 0)
+      rmovsl(d + n - 4, s + n - 4, n/4);
+    else
+      rmovsb(d + n - 1, s + n - 1, n);
+    return dst;
+  }
+  if(n >= 8){
+    head = -(uint)d & 3;
+    movsb(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    movsl(d, s, n/4);
+    d += n & ~3;
+    s += n & ~3;
+    n &= 3;
+  }
+  movsb(d, s, n);
   return dst;
 }
 
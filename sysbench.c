@@ -0,0 +1,73 @@
+// Null system call benchmark.
+// Times a long run of system calls that do next to no
+// work in the kernel, so the cost is almost all trap
+// entry, dispatch and return. Each call is made through
+// the sysenter stubs and through the int $T_SYSCALL path,
+// and compared with the ulib versions that read the
+// kernel's data pages without a trap.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "traps.h"
+
+#define CALLS 1000000
+
+int
+intsyscall(int num)
+{
+  int r;
+
+  asm volatile("int %1" : "=a" (r) : "i" (T_SYSCALL), "a" (num) : "memory");
+  return r;
+}
+
+void
+report(char *name, int n, int t)
+{
+  printf(1, "%s: %d calls in %d ticks", name, n, t);
+  if(t > 0)
+    printf(1, " (%d calls/tick)", n / t);
+  printf(1, "\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, t0;
+
+  n = argc > 1 ? atoi(argv[1]) : CALLS;
+
+  t0 = uptime();
+  for(i = 0; i < n; i++)
+    sysgetpid();
+  report("getpid (sysenter)", n, uptime() - t0);
+
+  t0 = uptime();
+  for(i = 0; i < n; i++)
+    sysuptime();
+  report("uptime (sysenter)", n, uptime() - t0);
+
+  t0 = uptime();
+  for(i = 0; i < n; i++)
+    intsyscall(SYS_getpid);
+  report("getpid (int)", n, uptime() - t0);
+
+  t0 = uptime();
+  for(i = 0; i < n; i++)
+    intsyscall(SYS_uptime);
+  report("uptime (int)", n, uptime() - t0);
+
+  t0 = uptime();
+  for(i = 0; i < n; i++)
+    getpid();
+  report("getpid (no trap)", n, uptime() - t0);
+
+  t0 = uptime();
+  for(i = 0; i < n; i++)
+    uptime();
+  report("uptime (no trap)", n, uptime() - t0);
+
+  exit();
+}
@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
@@ -106,6 +107,22 @@ extern int sys_uptime(void);
 extern int sys_waitx(void);
 extern int sys_set_priority(void);
 extern int sys_ps(void);
+extern int sys_vmsplice(void);
+extern int sys_readv(void);
+extern int sys_writev(void);
+extern int sys_pread(void);
+extern int sys_pwrite(void);
+extern int sys_ringenter(void);
+extern int sys_waitx2(void);
+extern int sys_clock_gettime(void);
+extern int sys_setsched(void);
+extern int sys_settickets(void);
+extern int sys_setdeadline(void);
+extern int sys_setaffinity(void);
+extern int sys_setagethres(void);
+extern int sys_mkgroup(void);
+extern int sys_setgroup(void);
+extern int sys_groupctl(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,6 +149,22 @@ static int (*syscalls[])(void) = {
 [SYS_waitx]   sys_waitx,
 [SYS_set_priority]    sys_set_priority,
 [SYS_ps]      sys_ps,
+[SYS_vmsplice] sys_vmsplice,
+[SYS_readv]   sys_readv,
+[SYS_writev]  sys_writev,
+[SYS_pread]   sys_pread,
+[SYS_pwrite]  sys_pwrite,
+[SYS_ringenter] sys_ringenter,
+[SYS_waitx2]  sys_waitx2,
+[SYS_clock_gettime] sys_clock_gettime,
+[SYS_setsched] sys_setsched,
+[SYS_settickets] sys_settickets,
+[SYS_setdeadline] sys_setdeadline,
+[SYS_setaffinity] sys_setaffinity,
+[SYS_setagethres] sys_setagethres,
+[SYS_mkgroup] sys_mkgroup,
+[SYS_setgroup] sys_setgroup,
+[SYS_groupctl] sys_groupctl,
 };
 
 void
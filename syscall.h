@@ -23,3 +23,19 @@
 #define SYS_waitx  22
 #define SYS_set_priority    23
 #define SYS_ps     24
+#define SYS_vmsplice 25
+#define SYS_readv  26
+#define SYS_writev 27
+#define SYS_pread  28
+#define SYS_pwrite 29
+#define SYS_ringenter 30
+#define SYS_waitx2 31
+#define SYS_clock_gettime 32
+#define SYS_setsched 33
+#define SYS_settickets 34
+#define SYS_setdeadline 35
+#define SYS_setaffinity 36
+#define SYS_setagethres 37
+#define SYS_mkgroup 38
+#define SYS_setgroup 39
+#define SYS_groupctl 40
@@ -9,12 +9,14 @@
 #include "param.h"
 #include "stat.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "fs.h"
-#include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "uio.h"
+#include "ring.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -90,6 +92,107 @@ sys_write(void)
   return filewrite(f, p, n);
 }
 
+// Fetch the nth and n+1th system call arguments as an array of
+// iovecs and its length, copy the array into iov, and check that
+// every buffer lies within the process address space.
+// Returns the number of iovecs.
+static int
+argiov(int n, struct iovec *iov)
+{
+  int cnt, i;
+  uint tot;
+  char *p;
+  struct proc *curproc = myproc();
+
+  if(argint(n+1, &cnt) < 0 || cnt < 0 || cnt > IOV_MAX)
+    return -1;
+  if(argptr(n, &p, cnt*sizeof(struct iovec)) < 0)
+    return -1;
+  memmove(iov, p, cnt*sizeof(struct iovec));
+  tot = 0;
+  for(i = 0; i < cnt; i++){
+    if((uint)iov[i].iov_base > curproc->sz ||
+       iov[i].iov_len > curproc->sz - (uint)iov[i].iov_base)
+      return -1;
+    tot += iov[i].iov_len;
+    if(tot > curproc->sz)  // keeps the total byte count an int
+      return -1;
+  }
+  return cnt;
+}
+
+int
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || (cnt = argiov(1, iov)) < 0)
+    return -1;
+  return filereadv(f, iov, cnt, -1);
+}
+
+int
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || (cnt = argiov(1, iov)) < 0)
+    return -1;
+  return filewritev(f, iov, cnt, -1);
+}
+
+// Read n bytes at byte offset off of the file without
+// using or moving the descriptor's offset, so that
+// processes sharing a descriptor do not race on it.
+int
+sys_pread(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argint(3, &off) < 0 ||
+     argptr(1, (char**)&iov.iov_base, n) < 0 || off < 0)
+    return -1;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, off);
+}
+
+int
+sys_pwrite(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argint(3, &off) < 0 ||
+     argptr(1, (char**)&iov.iov_base, n) < 0 || off < 0)
+    return -1;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, off);
+}
+
+// Write n bytes from p to a pipe like write(), but move
+// whole page-aligned pages of p into the pipe instead of
+// copying them. Those pages of p read as zeroes afterwards.
+int
+sys_vmsplice(void)
+{
+  struct file *f;
+  int n;
+  char *p;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+    return -1;
+  if(f->type != FD_PIPE || f->writable == 0)
+    return -1;
+  return pipegift(f->pipe, p, n);
+}
+
 int
 sys_close(void)
 {
@@ -218,6 +321,7 @@ sys_unlink(void)
   memset(&de, 0, sizeof(de));
   if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
     panic("unlink: writei");
+  dcacheenter(dp, name, 0, 0);
   if(ip->type == T_DIR){
     dp->nlink--;
     iupdate(dp);
@@ -282,17 +386,13 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-int
-sys_open(void)
+static int
+openpath(char *path, int omode)
 {
-  char *path;
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
-    return -1;
-
   begin_op();
 
   if(omode & O_CREATE){
@@ -332,6 +432,88 @@ sys_open(void)
   return fd;
 }
 
+int
+sys_open(void)
+{
+  char *path;
+  int omode;
+
+  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return openpath(path, omode);
+}
+
+// Carry out one ring operation for sys_ringenter(), checking
+// its arguments as the corresponding system call would.
+static int
+ringop(struct sqe *s, int *lastfd)
+{
+  struct proc *curproc = myproc();
+  struct file *f;
+  struct iovec iov;
+  char *path;
+  int fd;
+
+  if(s->op == RING_NOP)
+    return 0;
+  if(s->op == RING_OPEN){
+    if(fetchstr(s->addr, &path) < 0)
+      return -1;
+    return *lastfd = openpath(path, s->len);
+  }
+
+  fd = s->fd == RING_LASTFD ? *lastfd : s->fd;
+  if(fd < 0 || fd >= NOFILE || (f = curproc->ofile[fd]) == 0)
+    return -1;
+  switch(s->op){
+  case RING_CLOSE:
+    curproc->ofile[fd] = 0;
+    fileclose(f);
+    return 0;
+  case RING_READ:
+  case RING_WRITE:
+    if(s->len < 0 || s->addr >= curproc->sz || s->addr+s->len > curproc->sz)
+      return -1;
+    if(s->off < -1)
+      return -1;
+    iov.iov_base = (char*)s->addr;
+    iov.iov_len = s->len;
+    if(s->op == RING_READ)
+      return filereadv(f, &iov, 1, s->off);
+    return filewritev(f, &iov, 1, s->off);
+  }
+  return -1;
+}
+
+// Carry out the operations queued in the ring (see ring.h),
+// in order, with one trap for the whole batch.
+// Returns the number of operations completed.
+int
+sys_ringenter(void)
+{
+  struct ring *r;
+  struct sqe s;
+  struct cqe *c;
+  int n, lastfd;
+
+  if(argptr(0, (char**)&r, sizeof(*r)) < 0)
+    return -1;
+  lastfd = -1;
+  for(n = 0; r->sqhead != r->sqtail && r->cqtail - r->cqhead < RINGSIZE; n++){
+    if(myproc()->killed)
+      break;
+    // Copy the submission, since the operation itself
+    // may overwrite it (a read into the ring, say).
+    s = r->sq[r->sqhead % RINGSIZE];
+    r->sqhead++;
+    c = &r->cq[r->cqtail % RINGSIZE];
+    c->data = s.data;
+    c->res = ringop(&s, &lastfd);
+    r->cqtail++;
+  }
+  return n;
+}
+
 int
 sys_mkdir(void)
 {
@@ -5,7 +5,9 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
+#include "clock.h"
 
 int
 sys_fork(void)
@@ -60,21 +62,10 @@ int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  return sleepticks(n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -103,7 +94,49 @@ sys_waitx(void)
   if (argptr(1, (char **)&rtime, sizeof(int)) < 0)
     return -1;
 
-  return waitx(wtime, rtime);
+  uint64 r, w, io, g;
+  int group;
+  int pid = waitx(&r, &w, &io, &group, &g);
+  if (pid < 0)
+    return -1;
+  *wtime = cyc2ticks(w);
+  *rtime = cyc2ticks(r);
+  return pid;
+}
+
+// Like waitx, but reports the child's times in nanoseconds
+int
+sys_waitx2(void)
+{
+  struct ptimes *pt;
+  uint64 r, w, io, g;
+  int pid, group;
+
+  if (argptr(0, (char **)&pt, sizeof(*pt)) < 0)
+    return -1;
+
+  pid = waitx(&r, &w, &io, &group, &g);
+  if (pid < 0)
+    return -1;
+  pt->group = group;
+  cyc2ts(r, &pt->rtime);
+  cyc2ts(w, &pt->wtime);
+  cyc2ts(io, &pt->iotime);
+  cyc2ts(g, &pt->gtime);
+  return pid;
+}
+
+// Time since boot, to the resolution of the TSC
+int
+sys_clock_gettime(void)
+{
+  struct timespec *ts;
+
+  if (argptr(0, (char **)&ts, sizeof(*ts)) < 0)
+    return -1;
+
+  cyc2ts(rdtsc() - tscboot, ts);
+  return 0;
 }
 
 // Set priority system call
@@ -122,6 +155,133 @@ sys_set_priority(void)
   return set_priority(priority, pid);
 }
 
+// Set scheduling policy system call
+int
+sys_setsched(void)
+{
+  int pid;
+  int policy;
+
+  if (argint(0, &pid) < 0)
+    return -1;
+
+  if (argint(1, &policy) < 0)
+    return -1;
+
+  return setsched(pid, policy);
+}
+
+// Set tickets system call
+int
+sys_settickets(void)
+{
+  int pid;
+  int tickets;
+
+  if (argint(0, &pid) < 0)
+    return -1;
+
+  if (argint(1, &tickets) < 0)
+    return -1;
+
+  return settickets(pid, tickets);
+}
+
+// Set deadline system call, for the calling process
+int
+sys_setdeadline(void)
+{
+  int runtime, deadline, period;
+
+  if (argint(0, &runtime) < 0)
+    return -1;
+
+  if (argint(1, &deadline) < 0)
+    return -1;
+
+  if (argint(2, &period) < 0)
+    return -1;
+
+  return setdeadline(runtime, deadline, period);
+}
+
+// Set CPU affinity system call
+int
+sys_setaffinity(void)
+{
+  int pid;
+  int mask;
+
+  if (argint(0, &pid) < 0)
+    return -1;
+
+  if (argint(1, &mask) < 0)
+    return -1;
+
+  return setaffinity(pid, mask);
+}
+
+// Set MLFQ aging threshold system call
+int
+sys_setagethres(void)
+{
+  int n;
+
+  if (argint(0, &n) < 0)
+    return -1;
+
+  return setagethres(n);
+}
+
+// Make CPU group system call
+int
+sys_mkgroup(void)
+{
+  int parent;
+
+  if (argint(0, &parent) < 0)
+    return -1;
+
+  return mkgroup(parent);
+}
+
+// Move to CPU group system call
+int
+sys_setgroup(void)
+{
+  int pid;
+  int gid;
+
+  if (argint(0, &pid) < 0)
+    return -1;
+
+  if (argint(1, &gid) < 0)
+    return -1;
+
+  return setgroup(pid, gid);
+}
+
+// Set CPU group limits system call
+int
+sys_groupctl(void)
+{
+  int gid, shares, quota, period;
+
+  if (argint(0, &gid) < 0)
+    return -1;
+
+  if (argint(1, &shares) < 0)
+    return -1;
+
+  if (argint(2, &quota) < 0)
+    return -1;
+
+  if (argint(3, &period) < 0)
+    return -1;
+
+  return groupctl(gid, shares, quota, period);
+}
+
 // ps process table printing
 int
 sys_ps(void) {
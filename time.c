@@ -1,7 +1,18 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
- 
+#include "clock.h"
+
+// Print ts as milliseconds with three decimal places.
+static void
+printms(char *label, struct timespec *ts)
+{
+    uint us = ts->nsec / 1000;
+
+    printf(1, "%s\t%d.%d%d%d ms\n", label, ts->sec*1000 + us/1000,
+           us/100%10, us/10%10, us%10);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -23,13 +34,16 @@ main(int argc, char **argv)
     }
 
     // Parent code
-    uint run_time = 0;
-    uint wait_time = 0;
+    struct ptimes pt;
     int status;
-    status = waitx(&wait_time, &run_time);
+    status = waitx2(&pt);
     // status = wait();
 
-    printf(1, "\nProcess run time\t%d\nProcess wait time\t%d\nStatus\t%d\n", run_time, wait_time, status);
+    printf(1, "\n");
+    printms("Process run time", &pt.rtime);
+    printms("Process wait time", &pt.wtime);
+    printms("Process sleep time", &pt.iotime);
+    printf(1, "Status\t%d\n", status);
 
     exit();
 }
\ No newline at end of file
@@ -3,14 +3,16 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "traps.h"
-#include "spinlock.h"
+#include "vdso.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
+extern char sysentry[]; // in trapasm.S: sysenter entry point
 struct spinlock tickslock;
 uint ticks;
 
@@ -29,13 +31,47 @@ tvinit(void)
 void
 idtinit(void)
 {
+  uint edx;
+
   lidt(idt, sizeof(idt));
+
+  // sysenter loads %esp with the address of this CPU's
+  // ts.esp0, from which sysentry fetches the kernel stack
+  // that switchuvm() set up for the current process.
+  readcpuid(1, 0, 0, 0, &edx);
+  if(edx & CPUID_SEP){
+    wrmsr(MSR_SYSENTER_CS, SEG_KCODE<<3);
+    wrmsr(MSR_SYSENTER_ESP, (uint)&mycpu()->ts.esp0);
+    wrmsr(MSR_SYSENTER_EIP, (uint)sysentry);
+  }
+}
+
+// System calls made with sysenter come here from sysentry
+// in trapasm.S, skipping the dispatch on trapno in trap().
+void
+fastsyscall(struct trapframe *tf)
+{
+  if(myproc()->killed)
+    exit();
+  myproc()->tf = tf;
+  syscall();
+  if(myproc()->killed)
+    exit();
 }
 
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
 {
+  // On a CPU without sysenter, the usys.S stubs fault on it.
+  // Treat that as int $T_SYSCALL, returning where sysexit would.
+  if(tf->trapno == T_ILLOP && (tf->cs&3) == DPL_USER &&
+     tf->eip + 2 <= myproc()->sz && *(ushort*)tf->eip == 0x340f){
+    tf->eip = tf->edx;
+    tf->esp = tf->ecx;
+    tf->trapno = T_SYSCALL;
+  }
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -51,8 +87,7 @@ trap(struct trapframe *tf)
     if(cpuid() == 0){
       acquire(&tickslock);
       ticks++;
-      update_timing();
-      wakeup(&ticks);
+      vdso->ticks = ticks;
       release(&tickslock);
     }
     lapiceoi();
@@ -101,26 +136,14 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  #if !defined(FCFS)
-    // cprintf("It never got here\n");
-    
-    // Force process to give up CPU on clock tick.
-    // If interrupts were on while locks held, would need to check nlock.
-    if(myproc() && myproc()->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER) {
-      yield();
-      #ifdef MLFQ
-        if (myproc()->time_slices >= (1 << (myproc()->cur_queue + 1))) {
-          punisher();
-          yield();
-        } else {
-          inc_timeslice();
-          return; 
-        }
-      #endif
-    }
+  // Account the clock tick to this CPU's run queues, and let
+  // the process's scheduling class decide whether it gives up
+  // the CPU on it.
+  // If interrupts were on while locks held, would need to check nlock.
+  if(tf->trapno == T_IRQ0+IRQ_TIMER)
+    schedtick();
 
-    // Check if the process has been killed since we yielded
-    if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
-      exit();
-  #endif
+  // Check if the process has been killed since we yielded
+  if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
+    exit();
 }
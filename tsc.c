@@ -0,0 +1,98 @@
+// Time stamp counter calibration.
+//
+// The TSC counts at a fixed rate that the CPU does not report,
+// so count TSC cycles across an interval timed by channel 2 of
+// the 8253/8254 programmable interval timer, whose input clock
+// runs at 1193182 Hz. Channel 2's gate and output are wired to
+// the PC speaker port, so it can be started and polled without
+// taking any interrupts.
+//
+// The kernel keeps process times in TSC cycles and converts
+// them to ticks or nanoseconds only when reporting them.
+
+#include "types.h"
+#include "defs.h"
+#include "mmu.h"
+#include "x86.h"
+#include "param.h"
+#include "clock.h"
+
+#define PIT_HZ      1193182
+#define IO_PIT_CH2  0x42
+#define IO_PIT_CMD  0x43
+#define IO_PORTB    0x61    // bit 0: ch2 gate, 1: speaker, 5: ch2 output
+
+#define CALMS       10      // length of the calibration interval in ms
+
+uint tsckhz;     // TSC cycles per millisecond, 0 if unknown
+uint64 tscboot;  // TSC at boot
+
+void
+tscinit(void)
+{
+  uint edx, t0, t1, n;
+
+  readcpuid(1, 0, 0, 0, &edx);
+  if((edx & CPUID_TSC) == 0)
+    panic("tscinit: no TSC");
+  tscboot = rdtsc();
+
+  // Turn the gate on and the speaker off, then load channel 2
+  // in mode 0, which raises its output when the count runs out.
+  outb(IO_PORTB, (inb(IO_PORTB) & ~0x02) | 0x01);
+  outb(IO_PIT_CMD, 0xB0);  // channel 2, low then high byte, mode 0
+  outb(IO_PIT_CH2, (PIT_HZ/1000*CALMS) & 0xFF);
+  outb(IO_PIT_CH2, (PIT_HZ/1000*CALMS) >> 8);
+
+  t0 = rdtsc();
+  for(n = 0; (inb(IO_PORTB) & 0x20) == 0; n++)
+    if(n > 10000000)  // no PIT
+      return;
+  t1 = rdtsc();
+  tsckhz = (t1 - t0) / CALMS;
+}
+
+// Divide n by d without the 64-bit division routines
+// from libgcc, which the kernel is not linked with.
+uint64
+div64(uint64 n, uint d)
+{
+  uint hi, lo, r;
+
+  hi = (uint)(n >> 32) / d;
+  r = (uint)(n >> 32) % d;
+  asm("divl %4" : "=a" (lo), "=d" (r) : "a" ((uint)n), "d" (r), "rm" (d));
+  return (uint64)hi << 32 | lo;
+}
+
+// Convert a count of TSC cycles to timer ticks.
+uint
+cyc2ticks(uint64 c)
+{
+  if(tsckhz == 0)
+    return 0;
+  return div64(c, tsckhz * (1000/HZ));
+}
+
+// Convert microseconds to TSC cycles.
+uint64
+us2cyc(uint us)
+{
+  return div64((uint64)us * tsckhz, 1000);
+}
+
+// Convert a count of TSC cycles to seconds and nanoseconds.
+void
+cyc2ts(uint64 c, struct timespec *ts)
+{
+  uint64 ms;
+
+  if(tsckhz == 0){
+    ts->sec = ts->nsec = 0;
+    return;
+  }
+  ms = div64(c, tsckhz);
+  ts->sec = div64(ms, 1000);
+  ts->nsec = (uint)(ms - (uint64)ts->sec*1000) * 1000000 +
+             div64((c - ms*tsckhz) * 1000000, tsckhz);
+}
@@ -0,0 +1,9 @@
+// Buffers for the vectored I/O system calls readv() and writev().
+// Both the kernel and user programs use this header file.
+
+struct iovec {
+  void *iov_base;  // start of buffer
+  uint iov_len;    // size of buffer in bytes
+};
+
+#define IOV_MAX 16  // maximum iovecs per call
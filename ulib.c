@@ -3,6 +3,10 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "param.h"
+#include "memlayout.h"
+#include "vdso.h"
+#include "ring.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -33,10 +37,26 @@ strlen(const char *s)
   return n;
 }
 
+// Fill a byte at a time up to a word boundary,
+// then a word at a time, then the leftover bytes.
 void*
 memset(void *dst, int c, uint n)
 {
-  stosb(dst, c, n);
+  char *d;
+  uint head;
+
+  d = dst;
+  c &= 0xFF;
+  if(n >= 8){
+    head = -(uint)d & 3;
+    stosb(d, c, head);
+    d += head;
+    n -= head;
+    stosl(d, (c<<24)|(c<<16)|(c<<8)|c, n/4);
+    d += n & ~3;
+    n &= 3;
+  }
+  stosb(d, c, n);
   return dst;
 }
 
@@ -92,15 +112,93 @@ atoi(const char *s)
   return n;
 }
 
+// Copy with rep movs, a word at a time where possible.
+// Going forwards, bytes are copied first to word-align dst.
+// Overlapping moves to a higher address go backwards.
 void*
 memmove(void *vdst, const void *vsrc, int n)
 {
   char *dst;
   const char *src;
+  uint head;
 
   dst = vdst;
   src = vsrc;
-  while(n-- > 0)
-    *dst++ = *src++;
+  if(n <= 0)
+    return vdst;
+  if(src < dst && src + n > dst){
+    if((((uint)src | (uint)dst | n) & 3) == 0)
+      rmovsl(dst + n - 4, src + n - 4, n/4);
+    else
+      rmovsb(dst + n - 1, src + n - 1, n);
+    return vdst;
+  }
+  if(n >= 8){
+    head = -(uint)dst & 3;
+    movsb(dst, src, head);
+    dst += head;
+    src += head;
+    n -= head;
+    movsl(dst, src, n/4);
+    dst += n & ~3;
+    src += n & ~3;
+    n &= 3;
+  }
+  movsb(dst, src, n);
   return vdst;
 }
+
+void*
+memcpy(void *dst, const void *src, uint n)
+{
+  return memmove(dst, src, n);
+}
+
+int
+memcmp(const void *v1, const void *v2, uint n)
+{
+  const uchar *s1, *s2;
+
+  s1 = v1;
+  s2 = v2;
+  while(n-- > 0){
+    if(*s1 != *s2)
+      return *s1 - *s2;
+    s1++, s2++;
+  }
+  return 0;
+}
+
+// getpid() and uptime() read the kernel's read-only data
+// pages (see vdso.h) rather than making a system call.
+int
+getpid(void)
+{
+  return ((struct vproc*)VPROC)->pid;
+}
+
+int
+uptime(void)
+{
+  return ((struct vdso*)VDSO)->ticks;
+}
+
+// Queue an operation on r for the next ringenter().
+// Returns the sequence number that its completion will
+// carry as data, or -1 if the submission queue is full.
+int
+ringpush(struct ring *r, int op, int fd, void *addr, int len, int off)
+{
+  struct sqe *s;
+
+  if(r->sqtail - r->sqhead >= RINGSIZE)
+    return -1;
+  s = &r->sq[r->sqtail % RINGSIZE];
+  s->op = op;
+  s->fd = fd;
+  s->addr = (uint)addr;
+  s->len = len;
+  s->off = off;
+  s->data = r->sqtail;
+  return r->sqtail++;
+}
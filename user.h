@@ -1,5 +1,9 @@
 struct stat;
 struct rtcdate;
+struct iovec;
+struct ring;
+struct timespec;
+struct ptimes;
 
 // system calls
 int fork(void);
@@ -19,10 +23,10 @@ int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
 int dup(int);
-int getpid(void);
+int sysgetpid(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
+int sysuptime(void);
 
 // Waitx system call's corresponding user command
 int waitx(uint* wtime, uint* rtime);
@@ -30,11 +34,39 @@ int waitx(uint* wtime, uint* rtime);
 int set_priority(int new_priority, int pid);
 // Get a view of current process table
 int ps(void);
+// Write to a pipe, moving whole pages instead of copying them
+int vmsplice(int, void*, int);
+int readv(int, const struct iovec*, int);
+int writev(int, const struct iovec*, int);
+int pread(int, void*, int, int);
+int pwrite(int, const void*, int, int);
+int ringenter(struct ring*);
+// Waitx with the times in nanoseconds
+int waitx2(struct ptimes*);
+int clock_gettime(struct timespec*);
+// Move a process, or with pid 0 every process, to a scheduling policy
+int setsched(int pid, int policy);
+// Set the tickets of a process for stride and lottery scheduling
+int settickets(int pid, int tickets);
+// Reserve runtime us of every period us, due deadline us into it
+int setdeadline(uint runtime, uint deadline, uint period);
+// Restrict a process to the CPUs in mask (bit i for CPU i)
+int setaffinity(int pid, uint mask);
+// Set the ticks an MLFQ process waits before moving up a queue
+int setagethres(int ticks);
+// Make a CPU group under parent (-1 for the caller's group)
+int mkgroup(int parent);
+// Move a process into a CPU group
+int setgroup(int pid, int gid);
+// Set a group's shares, and its quota of CPU time per period in us
+int groupctl(int gid, int shares, int quota, int period);
 
 // ulib.c
 int stat(const char*, struct stat*);
 char* strcpy(char*, const char*);
 void *memmove(void*, const void*, int);
+void *memcpy(void*, const void*, uint);
+int memcmp(const void*, const void*, uint);
 char* strchr(const char*, char c);
 int strcmp(const char*, const char*);
 void printf(int, const char*, ...);
@@ -44,3 +76,6 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int getpid(void);
+int uptime(void);
+int ringpush(struct ring*, int, int, void*, int, int);
@@ -7,6 +7,11 @@
 #include "syscall.h"
 #include "traps.h"
 #include "memlayout.h"
+#include "uio.h"
+#include "ring.h"
+#include "sched.h"
+#include "vdso.h"
+#include "clock.h"
 
 char buf[8192];
 char name[3];
@@ -241,6 +246,145 @@ writetest1(void)
   printf(stdout, "big files ok\n");
 }
 
+// readv/writev move several buffers in order, and
+// pread/pwrite neither use nor move the file offset.
+void
+iovtest(void)
+{
+  int fd, i, fds[2];
+  struct iovec iov[3];
+
+  printf(stdout, "iov test\n");
+
+  for(i = 0; i < 700; i++)
+    buf[i] = 'a' + i % 26;
+  fd = open("iov", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf(stdout, "error: creat iov failed!\n");
+    exit();
+  }
+  iov[0].iov_base = "0123456789";
+  iov[0].iov_len = 10;
+  iov[1].iov_base = buf;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = buf;
+  iov[2].iov_len = 700;
+  if(writev(fd, iov, 3) != 710){
+    printf(stdout, "writev failed\n");
+    exit();
+  }
+  if(pwrite(fd, "XY", 2, 3) != 2 || write(fd, "Z", 1) != 1){
+    printf(stdout, "pwrite failed\n");
+    exit();
+  }
+  if(pread(fd, buf+1000, 8, 0) != 8 || memcmp(buf+1000, "012XY567", 8) != 0){
+    printf(stdout, "pread wrong data\n");
+    exit();
+  }
+  if(pread(fd, buf+1000, 10, 705) != 6 || buf[1005] != 'Z' ||
+     buf[1004] != buf[699]){
+    printf(stdout, "pread at end wrong\n");
+    exit();
+  }
+  close(fd);
+
+  fd = open("iov", O_RDONLY);
+  iov[0].iov_base = buf+1000;
+  iov[0].iov_len = 4;
+  iov[1].iov_base = buf+2000;
+  iov[1].iov_len = 1000;
+  if(readv(fd, iov, 2) != 711 || memcmp(buf+1000, "012X", 4) != 0 ||
+     memcmp(buf+2000, "Y56789", 6) != 0 || memcmp(buf+2006, buf, 700) != 0 ||
+     buf[2706] != 'Z'){
+    printf(stdout, "readv wrong data\n");
+    exit();
+  }
+  iov[0].iov_base = (char*)0xffffff00;
+  if(readv(fd, iov, 2) >= 0 || readv(fd, iov, IOV_MAX+1) >= 0){
+    printf(stdout, "readv accepted a bad iovec\n");
+    exit();
+  }
+  close(fd);
+  unlink("iov");
+
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit();
+  }
+  iov[0].iov_base = "ab";
+  iov[0].iov_len = 2;
+  iov[1].iov_base = "cde";
+  iov[1].iov_len = 3;
+  if(writev(fds[1], iov, 2) != 5 || pwrite(fds[1], "f", 1, 0) >= 0){
+    printf(stdout, "pipe writev failed\n");
+    exit();
+  }
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = buf+1;
+  iov[1].iov_len = 10;
+  if(readv(fds[0], iov, 2) != 5 || memcmp(buf, "abcde", 5) != 0){
+    printf(stdout, "pipe readv failed\n");
+    exit();
+  }
+  close(fds[0]);
+  close(fds[1]);
+  printf(stdout, "iov ok\n");
+}
+
+// a batch of ring operations completes in order, each
+// with the result its own system call would return.
+void
+ringtest(void)
+{
+  static struct ring r;
+  static int want[] = { 0, 5, 1, 5, 0, -1, -1, 0, -1 };
+  int i, n;
+
+  printf(stdout, "ring test\n");
+
+  ringpush(&r, RING_OPEN, 0, "ring", O_CREATE|O_RDWR, 0);
+  ringpush(&r, RING_WRITE, RING_LASTFD, "hello", 5, -1);
+  ringpush(&r, RING_WRITE, RING_LASTFD, "J", 1, 0);
+  ringpush(&r, RING_READ, RING_LASTFD, buf, sizeof(buf), 0);
+  ringpush(&r, RING_NOP, 0, 0, 0, 0);
+  ringpush(&r, RING_WRITE, NOFILE, "x", 1, -1);
+  ringpush(&r, RING_READ, RING_LASTFD, (void*)0xffffff00, 1, 0);
+  ringpush(&r, RING_CLOSE, RING_LASTFD, 0, 0, 0);
+  ringpush(&r, RING_CLOSE, RING_LASTFD, 0, 0, 0);
+  if((n = ringenter(&r)) != 9 || r.sqhead != 9 || r.cqtail != 9){
+    printf(stdout, "ringenter did %d ops\n", n);
+    exit();
+  }
+  for(i = 0; i < 9; i++){
+    if(r.cq[i].data != i || (i > 0 && r.cq[i].res != want[i]) || r.cq[0].res < 0){
+      printf(stdout, "ring op %d returned %d\n", i, r.cq[i].res);
+      exit();
+    }
+  }
+  if(memcmp(buf, "Jello", 5) != 0){
+    printf(stdout, "ring read wrong data\n");
+    exit();
+  }
+  r.cqhead = r.cqtail;
+
+  // a full completion queue stops the batch
+  r.cqhead -= RINGSIZE - 2;
+  for(i = 0; i < 4; i++)
+    ringpush(&r, RING_NOP, 0, 0, 0, 0);
+  if(ringenter(&r) != 2 || r.sqtail - r.sqhead != 2){
+    printf(stdout, "ring overran its completion queue\n");
+    exit();
+  }
+  r.cqhead = r.cqtail;
+  if(ringenter(&r) != 2){
+    printf(stdout, "ring lost submissions\n");
+    exit();
+  }
+  unlink("ring");
+  printf(stdout, "ring ok\n");
+}
+
 void
 createtest(void)
 {
@@ -400,6 +544,248 @@ preempt(void)
   printf(1, "preempt ok\n");
 }
 
+// run children under each scheduling policy in turn
+void
+schedtest(void)
+{
+  int i, j, orig, pid, last, old, fds[2];
+  volatile int k;
+  char c;
+
+  printf(1, "sched test\n");
+  orig = setsched(getpid(), SCHED_RR);
+  if(orig < 0 || setsched(getpid(), NSCHED) != -1){
+    printf(1, "setsched wrong result\n");
+    exit();
+  }
+  if(setsched(getpid(), SCHED_EDF) != -1){
+    printf(1, "setsched let a process be a deadline one\n");
+    exit();
+  }
+  last = orig;
+  for(i = 0; i < NSCHED; i++){
+    if(i == SCHED_EDF)
+      continue;
+    last = i;
+    if(setsched(getpid(), i) < 0){
+      printf(1, "setsched %d failed\n", i);
+      exit();
+    }
+    for(j = 0; j < 3; j++){
+      pid = fork();
+      if(pid < 0){
+        printf(1, "fork failed\n");
+        exit();
+      }
+      if(pid == 0){
+        for(k = 0; k < 1000000; k++)
+          ;
+        exit();
+      }
+    }
+    for(j = 0; j < 3; j++)
+      if(wait() < 0){
+        printf(1, "wait failed under policy %d\n", i);
+        exit();
+      }
+  }
+  if(setsched(getpid(), orig) != last){
+    printf(1, "setsched lost the policy\n");
+    exit();
+  }
+
+  // a deadline process's children do not inherit its reservation;
+  // the grandchild writes a byte to say it did not
+  if(pipe(fds) != 0){
+    printf(1, "pipe failed\n");
+    exit();
+  }
+  pid = fork();
+  if(pid == 0){
+    close(fds[0]);
+    if(setdeadline(0, 10000, 10000) != -1 || setdeadline(2000, 1000, 1000) != -1 ||
+       setdeadline(1000, 10000, 100000000) != -1){
+      printf(1, "setdeadline took bad parameters\n");
+      exit();
+    }
+    if(setdeadline(1000, 10000, 10000) != 0){
+      printf(1, "setdeadline failed\n");
+      exit();
+    }
+    pid = fork();
+    if(pid == 0){
+      if(setsched(getpid(), orig) != SCHED_EDF)
+        write(fds[1], "x", 1);
+      exit();
+    }
+    wait();
+    exit();
+  }
+  close(fds[1]);
+  if(read(fds[0], &c, 1) != 1){
+    printf(1, "child inherited a deadline reservation\n");
+    exit();
+  }
+  close(fds[0]);
+  wait();
+
+  // the MLFQ aging threshold can be changed and restored
+  old = setagethres(5);
+  if(old < 1 || setagethres(0) != -1 || setagethres(old) != 5){
+    printf(1, "setagethres failed\n");
+    exit();
+  }
+  printf(1, "sched ok\n");
+}
+
+// a process runs only on the CPUs its affinity allows
+void
+affinitytest(void)
+{
+  struct vdso *vdso = (struct vdso*)VDSO;
+  int i, n, old;
+
+  printf(1, "affinity test\n");
+  if(setaffinity(0, 0) != -1 || setaffinity(0, ~0 << vdso->ncpu) != -1){
+    printf(1, "setaffinity took an empty mask\n");
+    exit();
+  }
+  old = setaffinity(0, 1);
+  if(old != (1 << vdso->ncpu) - 1){
+    printf(1, "setaffinity returned %x\n", old);
+    exit();
+  }
+  for(i = 0; i < vdso->ncpu; i++){
+    setaffinity(0, 1 << i);
+    sleep(1);
+    for(n = 0; n < 100000; n++){
+      if(vdso->cpu[i].pid != getpid()){
+        printf(1, "ran outside cpu %d\n", i);
+        exit();
+      }
+    }
+  }
+  if(setaffinity(0, old) != 1 << (vdso->ncpu - 1)){
+    printf(1, "setaffinity lost the mask\n");
+    exit();
+  }
+  printf(1, "affinity ok\n");
+}
+
+// a process in a CPU group with a quota of 10% of the CPU
+// gets no more than that, and the group goes when it exits
+void
+grouptest(void)
+{
+  struct ptimes pt;
+  int gid, pid, end, ms;
+
+  printf(1, "group test\n");
+  if(groupctl(0, 1024, 0, 100000) != -1 || mkgroup(NGROUP) != -1){
+    printf(1, "groupctl took a bad group\n");
+    exit();
+  }
+  gid = mkgroup(-1);
+  if(gid <= 0 || groupctl(gid, 1024, 10000, 100) != -1){
+    printf(1, "mkgroup failed\n");
+    exit();
+  }
+  // an unused group can be deleted, but only once
+  if(groupctl(gid, 0, 0, 0) != 0 || groupctl(gid, 0, 0, 0) != -1 ||
+     setgroup(0, gid) != -1){
+    printf(1, "groupctl did not delete an empty group\n");
+    exit();
+  }
+  gid = mkgroup(-1);
+  pid = fork();
+  if(pid == 0){
+    if(setgroup(0, gid) != 0 || groupctl(gid, 512, 10000, 100000) != 0){
+      printf(1, "setgroup failed\n");
+      exit();
+    }
+    end = uptime() + 100;
+    while(uptime() < end)
+      ;
+    exit();
+  }
+  if(waitx2(&pt) != pid || pt.group != gid){
+    printf(1, "waitx2 lost the group\n");
+    exit();
+  }
+  ms = pt.rtime.sec * 1000 + pt.rtime.nsec / 1000000;
+  if(ms > 200){
+    printf(1, "group ran %d ms of its 100 ms quota\n", ms);
+    exit();
+  }
+  if(setgroup(0, gid) != -1){
+    printf(1, "group outlived its processes\n");
+    exit();
+  }
+  printf(1, "group ok\n");
+}
+
+// under PBS, a high priority process that needs an inode lock
+// held by a low priority one is not held up by processes of
+// priorities in between, which would starve the holder
+void
+inheritance(void)
+{
+  struct vdso *vdso = (struct vdso*)VDSO;
+  int fd, i, n, low, orig, end, start;
+
+  printf(1, "priority inheritance test\n");
+  orig = setsched(getpid(), SCHED_PBS);
+  fd = open("pifile", O_CREATE|O_RDWR);
+  write(fd, buf, 512);
+  close(fd);
+
+  low = fork();
+  if(low == 0){
+    set_priority(90, getpid());
+    for(;;){
+      fd = open("pifile", O_RDWR);
+      for(i = 0; i < 4; i++)
+        write(fd, buf, sizeof(buf));
+      close(fd);
+    }
+  }
+  sleep(2);
+
+  // CPU hogs above the writer's priority, for 300 ticks
+  end = uptime() + 300;
+  n = 2 * vdso->ncpu;
+  for(i = 0; i < n; i++){
+    if(fork() == 0){
+      set_priority(50, getpid());
+      while(uptime() < end)
+        ;
+      exit();
+    }
+  }
+  set_priority(1, getpid());
+  sleep(10);
+
+  start = uptime();
+  fd = open("pifile", O_RDWR);
+  if(fd < 0 || write(fd, "x", 1) != 1){
+    printf(1, "pifile write failed\n");
+    exit();
+  }
+  close(fd);
+  if(uptime() - start > 100){
+    printf(1, "high priority process waited %d ticks\n", uptime() - start);
+    exit();
+  }
+
+  set_priority(60, getpid());
+  kill(low);
+  for(i = 0; i < n + 1; i++)
+    wait();
+  unlink("pifile");
+  setsched(getpid(), orig);
+  printf(1, "priority inheritance ok\n");
+}
+
 // try to find any races between exit and wait
 void
 exitwait(void)
@@ -931,6 +1317,81 @@ bigdir(void)
   printf(1, "bigdir ok\n");
 }
 
+// time linking, opening and unlinking many names in one
+// directory, which is indexed once it outgrows a block.
+// The file system has too few inodes and blocks for 10k
+// files, so the names are links to one file.
+void
+bigdirindex(void)
+{
+  enum { N = 1000 };
+  int i, fd, t0, t1, t2, t3;
+  char name[8];
+
+  printf(1, "bigdirindex test\n");
+
+  if(mkdir("dx") != 0){
+    printf(1, "bigdirindex mkdir failed\n");
+    exit();
+  }
+  fd = open("dx/f", O_CREATE);
+  if(fd < 0){
+    printf(1, "bigdirindex create failed\n");
+    exit();
+  }
+  close(fd);
+
+  name[0] = 'd';
+  name[1] = 'x';
+  name[2] = '/';
+  name[7] = '\0';
+
+  t0 = uptime();
+  for(i = 0; i < N; i++){
+    name[3] = 'a' + i / 1000 % 10;
+    name[4] = '0' + i / 100 % 10;
+    name[5] = '0' + i / 10 % 10;
+    name[6] = '0' + i % 10;
+    if(link("dx/f", name) != 0){
+      printf(1, "bigdirindex link %s failed\n", name);
+      exit();
+    }
+  }
+  t1 = uptime();
+  for(i = 0; i < N; i++){
+    name[3] = 'a' + i / 1000 % 10;
+    name[4] = '0' + i / 100 % 10;
+    name[5] = '0' + i / 10 % 10;
+    name[6] = '0' + i % 10;
+    if((fd = open(name, O_RDONLY)) < 0){
+      printf(1, "bigdirindex open %s failed\n", name);
+      exit();
+    }
+    close(fd);
+  }
+  t2 = uptime();
+  for(i = 0; i < N; i++){
+    name[3] = 'a' + i / 1000 % 10;
+    name[4] = '0' + i / 100 % 10;
+    name[5] = '0' + i / 10 % 10;
+    name[6] = '0' + i % 10;
+    if(unlink(name) != 0){
+      printf(1, "bigdirindex unlink %s failed\n", name);
+      exit();
+    }
+  }
+  t3 = uptime();
+
+  if(unlink("dx/f") != 0 || unlink("dx") != 0){
+    printf(1, "bigdirindex cleanup failed\n");
+    exit();
+  }
+
+  printf(1, "bigdirindex: %d names: link %d open %d unlink %d ticks\n",
+         N, t1 - t0, t2 - t1, t3 - t2);
+  printf(1, "bigdirindex ok\n");
+}
+
 void
 subdir(void)
 {
@@ -1773,6 +2234,8 @@ main(int argc, char *argv[])
   opentest();
   writetest();
   writetest1();
+  iovtest();
+  ringtest();
   createtest();
 
   openiputtest();
@@ -1782,6 +2245,10 @@ main(int argc, char *argv[])
   mem();
   pipe1();
   preempt();
+  schedtest();
+  affinitytest();
+  grouptest();
+  inheritance();
   exitwait();
 
   rmdot();
@@ -1794,6 +2261,7 @@ main(int argc, char *argv[])
   iref();
   forktest();
   bigdir(); // slow
+  bigdirindex(); // slow
 
   uio();
 
@@ -0,0 +1,22 @@
+// Kernel data that user programs can read without a system call.
+// The kernel maps a struct vdso, shared by every process, read-only
+// at VDSO, and a struct vproc describing the process itself at VPROC.
+// Both the kernel and user programs use this header file.
+
+struct vdso {
+  volatile uint ticks;      // timer ticks since boot, as uptime()
+  uint tsckhz;              // TSC cycles per millisecond, 0 if unknown
+  uint ncpu;                // number of CPUs
+  struct {
+    uint apicid;            // local APIC ID
+    volatile int pid;       // pid of the process running there, 0 if idle
+    volatile uint nswitch;  // number of switches to a process
+    volatile uint load;     // recent average of runnable processes, x100
+    volatile uint nmigin;   // processes the load balancer moved here
+    volatile uint nmigout;  // and away from here
+  } cpu[NCPU];
+};
+
+struct vproc {
+  int pid;                  // process ID, as getpid()
+};
@@ -4,11 +4,14 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "elf.h"
+#include "vdso.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
+struct vdso *vdso;  // mapped read-only at VDSO in every process
 
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
@@ -16,17 +19,32 @@ void
 seginit(void)
 {
   struct cpu *c;
+  int apicid;
+
+  // mycpu() needs %gs, which is set up below, so find
+  // this CPU's struct cpu by its APIC ID instead.
+  apicid = lapicid();
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c->apicid == apicid)
+      break;
+  if(c == cpus+ncpu)
+    panic("seginit: unknown apicid");
 
   // Map "logical" addresses to virtual addresses using identity map.
   // Cannot share a CODE descriptor for both kernel and user
   // because it would have to have DPL_USR, but the CPU forbids
   // an interrupt from CPL=0 to DPL=3.
-  c = &cpus[cpuid()];
   c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
   c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+
+  // Map cpu and proc -- these are private per cpu.
+  c->gdt[SEG_KCPU] = SEG(STA_W, &c->self, 8, 0);
   lgdt(c->gdt, sizeof(c->gdt));
+  loadgs(SEG_KCPU << 3);
+  c->self = c;
+  c->proc = 0;
 }
 
 // Return the address of the PTE in page table pgdir
@@ -39,6 +57,8 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   pte_t *pgtab;
 
   pde = &pgdir[PDX(va)];
+  if(*pde & PTE_PS)
+    return 0;
   if(*pde & PTE_P){
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
@@ -87,8 +107,9 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 //
 // setupkvm() and exec() set up every page table like this:
 //
-//   0..KERNBASE: user memory (text+data+stack+heap), mapped to
+//   0..VPROC: user memory (text+data+stack+heap), mapped to
 //                phys memory allocated by the kernel
+//   VPROC..KERNBASE: read-only kernel data for the user (vdso.h)
 //   KERNBASE..KERNBASE+EXTMEM: mapped to 0..EXTMEM (for I/O space)
 //   KERNBASE+EXTMEM..data: mapped to EXTMEM..V2P(data)
 //                for the kernel's instructions and r/o data
@@ -99,6 +120,14 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 // The kernel allocates physical memory for its heap and for user memory
 // between V2P(end) and the end of physical memory (PHYSTOP)
 // (directly addressable from end..P2V(PHYSTOP)).
+//
+// The kernel half is built once, in kpgdir, and never changes
+// afterwards. setupkvm() gives each process a copy of kpgdir's
+// kernel PDEs, so every page directory shares the kernel's page-table
+// pages and freevm() frees only the user half. Whole 4 MB-aligned
+// stretches of the direct map use 4 MB (PTE_PS) pages and need no
+// page-table page at all. Kernel mappings are global (PTE_G), so
+// they stay in the TLB when %cr3 is reloaded on a context switch.
 
 // This table defines the kernel's mappings, which are present in
 // every process's page table.
@@ -114,36 +143,80 @@ static struct kmap {
  { (void*)DEVSPACE, DEVSPACE,      0,         PTE_W}, // more devices
 };
 
-// Set up kernel part of a page table.
+// Set up kernel part of a page table by sharing kpgdir's.
 pde_t*
 setupkvm(void)
 {
   pde_t *pgdir;
-  struct kmap *k;
 
   if((pgdir = (pde_t*)kalloc()) == 0)
     return 0;
-  memset(pgdir, 0, PGSIZE);
-  if (P2V(PHYSTOP) > (void*)DEVSPACE)
-    panic("PHYSTOP too high");
-  for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
-    if(mappages(pgdir, k->virt, k->phys_end - k->phys_start,
-                (uint)k->phys_start, k->perm) < 0) {
-      freevm(pgdir);
-      return 0;
-    }
+  memset(pgdir, 0, PDX(KERNBASE)*sizeof(pde_t));
+  memmove(&pgdir[PDX(KERNBASE)], &kpgdir[PDX(KERNBASE)],
+          (NPDENTRIES-PDX(KERNBASE))*sizeof(pde_t));
   return pgdir;
 }
 
 // Allocate one page table for the machine for the kernel address
-// space for scheduler processes.
+// space for scheduler processes, and fill in the mappings in kmap[]
+// that every other page table will share.
 void
 kvmalloc(void)
 {
-  kpgdir = setupkvm();
+  struct kmap *k;
+  char *va;
+  uint pa, size, n;
+
+  if((kpgdir = (pde_t*)kalloc()) == 0)
+    panic("kvmalloc");
+  memset(kpgdir, 0, PGSIZE);
+  if (P2V(PHYSTOP) > (void*)DEVSPACE)
+    panic("PHYSTOP too high");
+  for(k = kmap; k < &kmap[NELEM(kmap)]; k++){
+    va = k->virt;
+    pa = k->phys_start;
+    for(size = k->phys_end - pa; size > 0; size -= n){
+      n = PDSIZE - (uint)va % PDSIZE;
+      if(n > size)
+        n = size;
+      if(n == PDSIZE && pa % PDSIZE == 0)
+        kpgdir[PDX(va)] = pa | k->perm | PTE_P | PTE_PS | PTE_G;
+      else if(mappages(kpgdir, va, n, pa, k->perm | PTE_G) < 0)
+        panic("kvmalloc: out of memory");
+      va += n;
+      pa += n;
+    }
+  }
   switchkvm();
 }
 
+// Allocate the page of kernel data that every process sees at
+// VDSO. The kernel keeps it up to date as things change.
+void
+vdsoinit(void)
+{
+  int i;
+
+  if((vdso = (struct vdso*)kalloc()) == 0)
+    panic("vdsoinit");
+  memset(vdso, 0, PGSIZE);
+  vdso->tsckhz = tsckhz;
+  vdso->ncpu = ncpu;
+  for(i = 0; i < ncpu; i++)
+    vdso->cpu[i].apicid = cpus[i].apicid;
+}
+
+// Map the shared kernel data page at VDSO and the process's own
+// page vp at VPROC, both read-only for the user. The pages are
+// not freed by freevm().
+int
+mapvdso(pde_t *pgdir, char *vp)
+{
+  if(mappages(pgdir, (void*)VDSO, PGSIZE, V2P(vdso), PTE_U) < 0)
+    return -1;
+  return mappages(pgdir, (void*)VPROC, PGSIZE, V2P(vp), PTE_U);
+}
+
 // Switch h/w page table register to the kernel-only page table,
 // for when no process is running.
 void
@@ -224,7 +297,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= KERNBASE)
+  if(newsz > VPROC)
     return 0;
   if(newsz < oldsz)
     return oldsz;
@@ -271,8 +344,10 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       if(pa == 0)
         panic("kfree");
       char *v = P2V(pa);
-      kfree(v);
       *pte = 0;
+      if(rcr3() == V2P(pgdir))
+        invlpg((char*)a);
+      kfree(v);
     }
   }
   return newsz;
@@ -287,8 +362,8 @@ freevm(pde_t *pgdir)
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
-  deallocuvm(pgdir, KERNBASE, 0);
-  for(i = 0; i < NPDENTRIES; i++){
+  deallocuvm(pgdir, VPROC, 0);
+  for(i = 0; i < PDX(KERNBASE); i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
       kfree(v);
@@ -352,13 +427,35 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
   return (char*)P2V(PTE_ADDR(*pte));
 }
 
+// Exchange the physical page mapped at page-aligned user address
+// uva with the kernel page *kp: afterwards uva shows *kp's old
+// contents and *kp is the page uva used to map. pgdir must be the
+// current page table. Returns -1, changing nothing, unless uva
+// is mapped present, user and writable.
+int
+swapupage(pde_t *pgdir, char *uva, char **kp)
+{
+  pte_t *pte;
+  char *old;
+
+  if((pte = walkpgdir(pgdir, uva, 0)) == 0)
+    return -1;
+  if((*pte & (PTE_P|PTE_U|PTE_W)) != (PTE_P|PTE_U|PTE_W))
+    return -1;
+  old = P2V(PTE_ADDR(*pte));
+  *pte = V2P(*kp) | PTE_FLAGS(*pte);
+  *kp = old;
+  invlpg(uva);  // flush the stale translation
+  return 0;
+}
+
 // Copy len bytes from p to user address va in page table pgdir.
 // Most useful when pgdir is not the current page table.
 // uva2ka ensures this only works for PTE_U pages.
@@ -0,0 +1,107 @@
+// Fork and wait benchmark.
+// Times fork() and the wait() that reaps a zombie child while
+// a growing number of other processes, none of them ours,
+// sit idle, to show that neither depends on how many
+// processes there are.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "clock.h"
+
+#define ROUNDS 50
+#define BATCH  16  // zombies to reap each round
+
+static int idle[] = { 0, 64, 192, 448 };
+
+static uint
+elapsed(struct timespec *a, struct timespec *b)
+{
+  return (b->sec - a->sec) * 1000000000 + b->nsec - a->nsec;
+}
+
+// Start a process that forks n children which sleep until
+// fd[1] is closed, and reaps them.
+static int
+startidle(int n, int fd[2])
+{
+  int ready[2], pid, i;
+  char c;
+
+  if(pipe(fd) != 0 || pipe(ready) != 0){
+    printf(2, "waitbench: pipe failed\n");
+    exit();
+  }
+  pid = fork();
+  if(pid < 0){
+    printf(2, "waitbench: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    close(fd[1]);
+    for(i = 0; i < n; i++){
+      if((pid = fork()) < 0)
+        break;
+      if(pid == 0){
+        read(fd[0], &c, 1);
+        exit();
+      }
+    }
+    write(ready[1], &i, sizeof(i));
+    while(wait() >= 0)
+      ;
+    exit();
+  }
+  close(fd[0]);
+  close(ready[1]);
+  if(read(ready[0], &i, sizeof(i)) != sizeof(i) || i != n)
+    printf(2, "waitbench: only %d of %d idle processes\n", i, n);
+  close(ready[0]);
+  return pid;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct timespec t0, t1;
+  int fd[2], rounds, helper, i, j, k, pid;
+  uint forkns, waitns;
+
+  rounds = argc > 1 ? atoi(argv[1]) : ROUNDS;
+
+  for(i = 0; i < sizeof(idle) / sizeof(idle[0]); i++){
+    helper = startidle(idle[i], fd);
+    forkns = waitns = 0;
+    for(j = 0; j < rounds; j++){
+      clock_gettime(&t0);
+      for(k = 0; k < BATCH; k++){
+        if((pid = fork()) < 0){
+          printf(2, "waitbench: fork failed\n");
+          exit();
+        }
+        if(pid == 0)
+          exit();
+      }
+      clock_gettime(&t1);
+      forkns += elapsed(&t0, &t1) / BATCH;
+
+      // Let them all become zombies, then reap them.
+      sleep(2);
+      clock_gettime(&t0);
+      for(k = 0; k < BATCH; k++)
+        if(wait() < 0){
+          printf(2, "waitbench: wait failed\n");
+          exit();
+        }
+      clock_gettime(&t1);
+      waitns += elapsed(&t0, &t1) / BATCH;
+    }
+    printf(1, "%d idle processes: fork %d ns, wait %d ns\n",
+           idle[i], forkns / rounds, waitns / rounds);
+
+    close(fd[1]);
+    if(wait() != helper)
+      printf(2, "waitbench: lost the idle processes\n");
+  }
+  exit();
+}